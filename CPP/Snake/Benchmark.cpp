@@ -0,0 +1,351 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "Board.hpp"
+#include "BoardBatch.hpp"
+#include "Headless.hpp"
+#include "Strategy.hpp"
+#include "MonteCarloPilot.hpp"
+#include "SharedBoard.hpp"
+#include "Solver.hpp"
+#include "ThreadPool.hpp"
+
+
+////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////
+
+// Board dimensions and the number of seeded games played on each (seeds 1..games)
+struct Corpus {
+    IntT dim;
+    unsigned games;
+};
+
+const std::vector<Corpus> corpus = { { 4, 100 }, { 5, 30 }, { 6, 200 }, { 8, 100 }, { 10, 50 }, { 12, 30 }, { 16, 12 }, { 20, 4 } };
+const IntT startingLength = 2;
+
+// Boards up to this dimension get the fewest moves to win from Solver as a reference (larger ones take too long)
+const IntT solverMaxDim = 5;
+const size_t solverStates = 1 << 21;
+
+// Fewest moves to win the seeds 1.. of boards that take too long to solve on every run (about 70 CPU-seconds for
+// 5x5), from Solver(dim, startingLength, solverStates). Every seed was solved and can be won. They only depend on the
+// rules and items of Board, so they have to be solved again when those change. A few quick seeds are solved on every
+// run; if one of them differs, the table is stale, every seed is solved instead and the benchmark fails
+struct SolvedSeeds {
+    IntT dim;
+    std::vector<long long> moves;
+    std::vector<unsigned> checked;              // Seeds solved again on every run (under a second each)
+};
+
+const std::vector<SolvedSeeds> solvedSeeds = {
+    { 5, { 60, 68, 64, 68, 66, 66, 62, 64, 70, 64, 58, 66, 60, 64, 66, 64, 72, 68, 60, 72, 66, 72, 74, 66, 68, 56, 70, 66,
+        72, 64 }, { 1, 7 } },
+};
+
+// Lockstep games of BoardBatch, checked against Board
+const IntT batchDim = 8;
+const size_t batchGames = 1024;
+const unsigned batchSteps = 1000;
+
+// Tile index type of the boards
+enum class Tiles { Int, Compact, Auto };
+
+// Autopilot playing the games
+enum class Pilot { Heuristic, MonteCarlo };
+
+
+////////////////////////////////////////////////////////////
+// Variables
+////////////////////////////////////////////////////////////
+
+// Publishes the game being played for external viewers (if opened)
+static SharedBoardWriter exporter;
+
+
+////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////
+
+// Speed and quality of the autopilot on one board dimension
+struct Report {
+    IntT dim = 0;
+    unsigned games = 0;
+    size_t tileBytes = 0;
+    double movesPerSec = 0;
+    double cpuUsPerDecision = 0;
+    double winRate = 0;
+    double meanFinalLength = 0;
+    double movesPerItem = 0;
+    double deadlineHitRate = 0;
+    std::vector<long long> wonMoves;            // Moves of the game of every seed that was won (-1 if it was lost)
+
+    // Solver reference (only for boards up to solverMaxDim)
+    bool reference = false;
+    double solvedRate = 0;                      // Seeds the solver finished
+    double optimalMoves = 0;                    // Mean fewest moves to win of the seeds that can be won
+    double movesOverOptimal = 0;                // Mean ratio of the moves of a won game to the fewest moves
+};
+
+// Plays the seeded games of one corpus entry on boards of type BoardT with strategy Strategy
+template <typename Strategy, typename BoardT>
+static Report run(const Corpus& entry, Fallback fallback, std::chrono::microseconds budget, IntT itemCount) {
+    long long moves = 0, decisions = 0, items = 0, length = 0, wins = 0, deadlineHits = 0;
+    std::vector<long long> wonMoves(entry.games, -1);
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    const std::clock_t cpuStart = std::clock();
+    for (unsigned seed = 1; seed <= entry.games; ++seed) {
+        BoardT board(entry.dim, startingLength, seed);
+        board.set_fallback(fallback);
+        board.set_item_count(itemCount);
+        Strategy pilot;
+        auto result = playGame(board, pilot, LLONG_MAX, budget, exporter.is_open() ? &exporter : nullptr);
+
+        moves += result.moves;
+        decisions += result.decisions;
+        items += result.items;
+        length += result.length;
+        wins += result.won;
+        deadlineHits += result.deadlineHits;
+        if (result.won)
+            wonMoves[seed - 1] = result.moves;
+    }
+    const double cpu = double(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    Report report;
+    report.dim = entry.dim;
+    report.games = entry.games;
+    report.tileBytes = sizeof(typename BoardT::Tiles::value_type);
+    report.movesPerSec = moves / wall;
+    report.cpuUsPerDecision = 1e6 * cpu / decisions;
+    report.winRate = double(wins) / entry.games;
+    report.meanFinalLength = double(length) / entry.games;
+    report.movesPerItem = double(moves) / std::max(items, 1LL);     // Every move if no item was eaten (JSON has no inf)
+    report.deadlineHitRate = double(deadlineHits) / decisions;
+    report.wonMoves = std::move(wonMoves);
+    return report;
+}
+
+// Solves the checked seeds of stored again. Returns false (and reports the first that differs) if stored is stale
+static bool checkSolvedSeeds(const Solver& solver, const SolvedSeeds& stored) {
+    std::vector<Solver::Result> results(stored.checked.size());
+    ThreadPool::shared().parallel_for(results.size(), [&](size_t i) {
+        results[i] = solver.solve(stored.checked[i]);
+    });
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const long long expected = stored.moves[stored.checked[i] - 1];
+        if (results[i].moves != expected) {
+            std::fprintf(stderr, "solvedSeeds is stale: seed %u of %dx%d takes %lld moves, not %lld\n", stored.checked[i],
+                stored.dim, stored.dim, results[i].moves, expected);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Solves the seeded games of report on all cores (or takes them from solvedSeeds) and compares the won games to the
+// fewest moves. Returns false if the stored seeds of the size are stale (they are all solved then)
+static bool addReference(Report& report) {
+    const Solver solver(report.dim, startingLength, solverStates);
+    auto stored = std::find_if(solvedSeeds.begin(), solvedSeeds.end(), [&](const SolvedSeeds& s) { return s.dim == report.dim; });
+    const bool fresh = stored == solvedSeeds.end() || checkSolvedSeeds(solver, *stored);
+    if (!fresh)
+        stored = solvedSeeds.end();
+    std::vector<Solver::Result> results(report.games);
+    ThreadPool::shared().parallel_for(report.games, [&](size_t i) {
+        if (stored != solvedSeeds.end() && i < stored->moves.size())
+            results[i] = { true, stored->moves[i] };
+        else
+            results[i] = solver.solve(i + 1);
+    });
+
+    long long solved = 0, winnable = 0, optimal = 0, compared = 0;
+    double ratio = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        solved += results[i].solved;
+        if (results[i].moves > 0) {
+            ++winnable;
+            optimal += results[i].moves;
+            if (report.wonMoves[i] > 0) {
+                ++compared;
+                ratio += double(report.wonMoves[i]) / results[i].moves;
+            }
+        }
+    }
+    report.reference = true;
+    report.solvedRate = double(solved) / report.games;
+    report.optimalMoves = winnable ? double(optimal) / winnable : 0;
+    report.movesOverOptimal = compared ? ratio / compared : 0;
+    return fresh;
+}
+
+// Speed of BoardBatch and the steps in which it disagreed with Board
+struct BatchReport {
+    double stepsPerSec = 0;                     // Game steps (one move of one game) per second
+    long long finished = 0;                     // Games that died or were won
+    long long mismatches = 0;                   // Game steps whose outcome, length, head or item differ from Board
+};
+
+// Steps batchGames games of BoardBatch and one Board per game with the same seeds and the same random actions (mostly
+// legal ones, so the games get long). Only the steps of the batch are timed
+static BatchReport runBatch(bool resetOnDone) {
+    BoardBatch batch(batchGames, batchDim, startingLength, 1, resetOnDone);
+    std::vector<Board> boards;
+    std::vector<char> over(batchGames, false);
+    for (size_t g = 0; g < batchGames; ++g)
+        boards.emplace_back(batchDim, startingLength, g + 1);
+    unsigned nextSeed = batchGames + 1;
+
+    const IntT size = batch.size();
+    const IntT offsets[4] = { -size, size, -1, 1 };
+    std::vector<BoardBatch::Action> actions(batchGames);
+    Pcg32 random(2024);
+    BatchReport report;
+    double seconds = 0;
+
+    for (unsigned step = 0; step < batchSteps; ++step) {
+        // Games that are over start again with the next seed, in the order the batch resets them
+        for (size_t g = 0; g < batchGames; ++g) {
+            Board& board = boards[g];
+            if (over[g] && resetOnDone) {
+                board = Board(batchDim, startingLength, nextSeed++);
+                over[g] = false;
+            }
+            IntT action = random_below(random, 4);
+            for (int tries = 0; tries < 3 && random_below(random, 8) != 0 && !board.can_move(board.head(board.snake()) + offsets[action]); ++tries)
+                action = (action + 1) % 4;
+            actions[g] = BoardBatch::Action(action);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        batch.step(actions);
+        seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (size_t g = 0; g < batchGames; ++g) {
+            Board& board = boards[g];
+            BoardBatch::Outcome outcome = BoardBatch::Done;
+            if (!over[g]) {
+                const IntT newHead = board.head(board.snake()) + offsets[actions[g]];
+                if (!board.can_move(newHead))
+                    outcome = BoardBatch::Died;
+                else if (board.move_head(newHead))
+                    outcome = board.gameOver() ? BoardBatch::Won : BoardBatch::Ate;
+                else
+                    outcome = BoardBatch::Moved;
+                over[g] = outcome == BoardBatch::Died || outcome == BoardBatch::Won;
+                report.finished += over[g];
+            }
+
+            const bool same = outcome == batch.outcomes()[g] && board.snake_length() == batch.length(g) &&
+                board.head(board.snake()) == batch.head(g) && (over[g] || board.item() == batch.item(g));
+            report.mismatches += !same;
+        }
+    }
+    report.stepsPerSec = batchSteps * batchGames / seconds;
+    return report;
+}
+
+// Plays the seeded games of one corpus entry with the chosen strategy and tile index type (Auto: 16 bits when the board
+// fits, the Monte Carlo pilot always plays on Board)
+static Report run(const Corpus& entry, Pilot pilot, Tiles tiles, Fallback fallback, std::chrono::microseconds budget, IntT itemCount) {
+    if (pilot == Pilot::MonteCarlo)
+        return run<MonteCarloPilot, Board>(entry, fallback, budget, itemCount);
+    if (tiles == Tiles::Compact || (tiles == Tiles::Auto && fits_compact_tiles(entry.dim)))
+        return run<HeuristicPilot, CompactBoard>(entry, fallback, budget, itemCount);
+    return run<HeuristicPilot, Board>(entry, fallback, budget, itemCount);
+}
+
+
+////////////////////////////////////////////////////////////
+/// Autopilot regression benchmark. Plays a fixed corpus of seeded
+/// games on several board sizes with an autopilot strategy and
+/// prints speed and play quality per size as JSON (compare two
+/// outputs with bench_compare.py). The strategy is the heuristic of
+/// Board::autoPilotStep() (bfs, the default) or the Monte Carlo
+/// pilot (mc, on int tiles, within its own budget unless one is
+/// given). The boards use 32-bit tiles (int), 16-bit tiles
+/// (compact) or 16-bit tiles where they fit (auto, the default).
+/// The autopilot falls back on the longest path to the tail (path,
+/// the default) or on the largest reachable region (fill). With a
+/// budget in microseconds, every decision has a deadline and the
+/// output counts how often it was hit. items puts that many items
+/// on the board at the same time. On the smallest boards (with one
+/// item), Solver finds the fewest moves to win every seed (5x5
+/// takes them from solvedSeeds, and fails if the seeds it solves
+/// again differ), and the output compares the won games to them.
+/// With a shared memory name (e.g. /snake), the game being played
+/// is published there for viewers (see SharedBoard.hpp, SnakeGame
+/// --view). Last, it steps BoardBatch games and one Board per game
+/// with the same seeds and actions, and fails if they disagree.
+///
+/// Usage: Benchmark [output.json | -] [int | compact | auto] [path | fill] [budget_us] [items] [bfs | mc] [shm_name]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    FILE* out = argc > 1 && std::strcmp(argv[1], "-") != 0 ? std::fopen(argv[1], "w") : stdout;
+    if (!out)
+        return EXIT_FAILURE;
+
+    Tiles tiles = Tiles::Auto;
+    if (argc > 2)
+        tiles = std::strcmp(argv[2], "int") == 0 ? Tiles::Int : std::strcmp(argv[2], "compact") == 0 ? Tiles::Compact : Tiles::Auto;
+    Fallback fallback = argc > 3 && std::strcmp(argv[3], "fill") == 0 ? Fallback::FloodFill : Fallback::LongestPath;
+    std::chrono::microseconds budget(argc > 4 ? std::atoll(argv[4]) : 0);
+    IntT items = argc > 5 ? std::atoi(argv[5]) : 1;
+    Pilot pilot = argc > 6 && std::strcmp(argv[6], "mc") == 0 ? Pilot::MonteCarlo : Pilot::Heuristic;
+    if (argc > 7 && !exporter.open(argv[7], corpus.back().dim))
+        std::fprintf(stderr, "Cannot open shared memory %s\n", argv[7]);
+
+    std::fprintf(out, "{\n  \"benchmark\": \"autopilot\",\n  \"strategy\": \"%s\",\n  \"fallback\": \"%s\",\n  \"items\": %d,\n  \"sizes\": [\n",
+        pilot == Pilot::MonteCarlo ? MonteCarloPilot::name : HeuristicPilot::name, fallback == Fallback::FloodFill ? "fill" : "path", items);
+    bool staleSeeds = false;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        auto r = run(corpus[i], pilot, tiles, fallback, budget, items);
+        if (corpus[i].dim <= solverMaxDim && items == 1)
+            staleSeeds |= !addReference(r);
+
+        std::fprintf(out, "    { \"size\": %d, \"games\": %u, \"tile_bytes\": %zu, \"moves_per_sec\": %.1f, \"cpu_us_per_decision\": %.3f, "
+            "\"win_rate\": %.4f, \"mean_final_length\": %.3f, \"moves_per_item\": %.3f, \"deadline_hit_rate\": %.4f",
+            r.dim, r.games, r.tileBytes, r.movesPerSec, r.cpuUsPerDecision, r.winRate, r.meanFinalLength, r.movesPerItem, r.deadlineHitRate);
+        if (r.reference)
+            std::fprintf(out, ", \"solved_rate\": %.4f, \"optimal_moves\": %.3f, \"moves_over_optimal\": %.4f",
+                r.solvedRate, r.optimalMoves, r.movesOverOptimal);
+        std::fprintf(out, " }%s\n", i + 1 < corpus.size() ? "," : "");
+        std::fflush(out);
+    }
+    std::fprintf(out, "  ],\n");
+
+    // BoardBatch with and without restarting the games that are over, against Board
+    long long mismatches = 0;
+    std::fprintf(out, "  \"batch\": [\n");
+    for (bool resetOnDone : { true, false }) {
+        auto r = runBatch(resetOnDone);
+        mismatches += r.mismatches;
+        std::fprintf(out, "    { \"size\": %d, \"games\": %zu, \"steps\": %u, \"reset_on_done\": %s, \"steps_per_sec\": %.1f, "
+            "\"finished\": %lld, \"mismatches\": %lld }%s\n", batchDim, batchGames, batchSteps, resetOnDone ? "true" : "false",
+            r.stepsPerSec, r.finished, r.mismatches, resetOnDone ? "," : "");
+    }
+    std::fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        std::fclose(out);
+    if (mismatches > 0)
+        std::fprintf(stderr, "BoardBatch disagreed with Board in %lld game steps\n", mismatches);
+    return mismatches > 0 || staleSeeds ? EXIT_FAILURE : EXIT_SUCCESS;
+}
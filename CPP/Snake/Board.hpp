@@ -1,3 +1,4 @@
+#pragma once
 
 ////////////////////////////////////////////////////////////
 // Headers
@@ -9,38 +10,170 @@
 #include <queue>
 #include <array>
 #include <vector>
-#include <random>
 #include <chrono>
+#include <sstream>
+#include <string>
+#include <span>
+#include <memory_resource>
+#include <atomic>
+#include <limits>
+#include <cstdint>
+#include <tuple>
+
+#include "ScratchArena.hpp"
+#include "DistanceField.hpp"
+#include "Zobrist.hpp"
+#include "ThreadPool.hpp"
+#include "BoardGraph.hpp"
+#include "FreeCells.hpp"
+#include "Random.hpp"
 
 
 using IntT = int;	//size_t;
 using VecIntT = std::vector<IntT>;
 
 
+////////////////////////////////////////////////////////////
+/// Neighbours holds the (at most four) neighbouring tiles 
+/// of a tile inline, so enumerating them never allocates.
+////////////////////////////////////////////////////////////
+template <typename TileT>
+class BasicNeighbours {
+public:
+	// Appends a tile (there is room for four)
+	void push_back(TileT tile) {
+		_tiles[_count++] = tile;
+	}
+
+	size_t size() const {
+		return _count;
+	}
+
+	bool empty() const {
+		return _count == 0;
+	}
+
+	TileT operator[](size_t i) const {
+		return _tiles[i];
+	}
+
+	const TileT* begin() const {
+		return _tiles.data();
+	}
+
+	const TileT* end() const {
+		return _tiles.data() + _count;
+	}
+
+private:
+	std::array<TileT, 4> _tiles{};
+	size_t _count = 0;
+};
+
+using Neighbours = BasicNeighbours<IntT>;
+
+
+// How the autopilot picks a move when neither the item nor the tail can be followed safely
+enum class Fallback {
+	LongestPath,								// Neighbour of the head with the longest shortest path to the tail
+	FloodFill									// Neighbour of the head that reaches the tail, with the largest reachable region
+};
+
+
+// Knobs of the autopilot heuristic (the defaults are the original rules, see Tuner.cpp for searching better ones)
+struct PilotSettings {
+	double tailChase = 1;						// Decisions in a row the snake may follow its tail, per segment
+	double giveUp = 3;							// Alternative moves since the last item after which the game is lost, per segment
+	int rotation = 1;							// Steps the neighbour order rotates by before every decision (0 to 3)
+
+	friend bool operator==(const PilotSettings&, const PilotSettings&) = default;
+};
+
+
 ////////////////////////////////////////////////////////////
 /// Board class holds data about the current state of the board 
 /// as well as algorithms for shifting the snake, generating 
-/// new item or even auto-piloting the snake itself.
+/// new item or even auto-piloting the snake itself. Tiles are
+/// stored as TileT, so boards that fit can use 16-bit tiles (see
+/// CompactBoard) and halve the memory of the body, the path and
+/// the searches. Items come from a RandomT engine (see Random.hpp),
+/// so a seed gives the same game on every platform.
 ////////////////////////////////////////////////////////////
-class Board {
+template <typename TileT, typename RandomT = Pcg32>
+class BasicBoard {
 public:
-	Board(){} 
+	using Tiles = std::vector<TileT>;
+	using Random = RandomT;
+	using ScratchTiles = std::pmr::vector<TileT>;		// Temporaries of a single autopilot step
+	using Clock = std::chrono::steady_clock;
+
+	// Everything needed to resume a game from a given move (see restore())
+	struct Snapshot {
+		IntT size = 0;
+		std::array<int, 4> neighbor_dirs{0,0,0,0};
+		Tiles snake;
+		TileT item = 0;
+		Tiles path;
+		IntT cycle1 = 0;
+		IntT cycle2 = 0;
+		bool toItem = false;
+		bool gameOver = false;
+		std::string generator;					// Serialized state of _generator
+		IntT itemCount = 1;
+		Tiles extraItems;
+		std::shared_ptr<const BoardGraph> graph;	// Playable tiles (a rectangular board of size if null)
+	};
+
+	// State of the autopilot that a decision changes besides the path (see pilot_state())
+	struct PilotState {
+		IntT cycle1 = 0;
+		IntT cycle2 = 0;
+		IntT rotation = 0;						// Index (0-3, up, down, left, right) of the first neighbour direction
+		bool toItem = false;
+
+		friend bool operator==(const PilotState&, const PilotState&) = default;
+	};
+
+	BasicBoard(){} 
+
+	BasicBoard(IntT s, IntT len) : BasicBoard(s, len, random_seed()) {}
+
+	// Board whose items are generated from a seed (the same seed gives the same game)
+	BasicBoard(IntT s, IntT len, std::uint64_t seed) : BasicBoard(BoardGraph::rectangular(s), len, seed) {}
 
-	Board(IntT s, IntT len) : _size(s + 2), _neighbor_dirs{ _size * -1 , _size , -1, 1 }, _snake(init_snake(len)), _generator(std::chrono::system_clock::now().time_since_epoch().count()), 
-		_distribution(0, _size * _size), _item(generate_item()) {}
+	// Board with the playable tiles of graph (e.g. a map with obstacles from BoardGraph::load())
+	BasicBoard(std::shared_ptr<const BoardGraph> graph, IntT len) 
+		: BasicBoard(std::move(graph), len, random_seed()) {}
+
+	BasicBoard(std::shared_ptr<const BoardGraph> graph, IntT len, std::uint64_t seed) : _size(graph->size()), _graph(std::move(graph)),
+		_neighbor_dirs{ _size * -1 , _size , -1, 1 }, _snake(init_snake(len)), _generator(seed), 
+		_item(generate_item()) {
+		_keys = ZobristKeys::for_tiles(_size * _size);
+		rehash();
+		reserve_autopilot();
+	}
 
 	// Return dimensions of the board
 	IntT size() const {
 		return _size;
 	}
 
+	// Playable tiles of the board and their neighbours
+	const BoardGraph& graph() const {
+		return *_graph;
+	}
+
 	// Assign new value to _snake
-	void set_snake(const VecIntT& snake) {
+	void set_snake(const Tiles& snake) {
 		_snake = snake;
+		_escape.clear();
+		_seenStates.clear();
+		rebuild_free_cells();
+		rehash();
 	}
 
 	// Returns a reference to _snake
-	VecIntT const& snake() const {
+	Tiles const& snake() const {
 		return _snake;
 	}
 
@@ -50,27 +183,74 @@ public:
 	}
 
 	// Returns head of the snake (first element of the vector)
-	IntT head(const VecIntT& snake) const {
+	TileT head(std::span<const TileT> snake) const {
 		return snake[0];
 	}
 
 	// Returns tail of the snake (last element of the vector)
-	IntT tail(const VecIntT& snake) const {
+	TileT tail(std::span<const TileT> snake) const {
 		return snake[snake.size() - 1];
 	}
 
 	// Returns _item
-	IntT item() {
+	TileT item() const {
 		return _item;
 	}
 
 	// Assigns _item a new value
-	void set_item(IntT i) {
+	void set_item(TileT i) {
+		if (_keys)
+			_hash ^= _keys->item(_item) ^ _keys->item(i);
+		if (_itemCount > 1) {
+			if (!contains(_snake, _item))
+				_free.add(_item);
+			_free.remove(i);
+		}
 		_item = i;
 	}
 
+	// Number of items on the board at the same time (while there is room for them)
+	IntT item_count() const {
+		return _itemCount;
+	}
+
+	// Puts count items on the board at the same time. With more than one item, new items are drawn from the free cells
+	void set_item_count(IntT count) {
+		for (auto item : _extraItems)
+			_hash ^= _keys ? _keys->item(item) : 0;
+		_extraItems.clear();
+		_itemCount = std::max<IntT>(count, 1);
+
+		rebuild_free_cells();
+		while ((IntT)_extraItems.size() + 1 < _itemCount && !_free.empty()) {
+			_extraItems.push_back(take_free_cell());
+			_hash ^= _keys ? _keys->item(_extraItems.back()) : 0;
+		}
+	}
+
+	// Items besides item()
+	Tiles const& extra_items() const {
+		return _extraItems;
+	}
+
+	// An item lies on tile
+	bool is_item(IntT tile) const {
+		return tile == _item || (!_extraItems.empty() && std::find(_extraItems.begin(), _extraItems.end(), tile) != _extraItems.end());
+	}
+
+	const PilotSettings& pilot_settings() const {
+		return _pilot;
+	}
+
+	void set_pilot_settings(const PilotSettings& settings) {
+		_pilot = settings;
+	}
+
 	// Shift directions by one
 	void shift_neighbors() {
+		if (_keys)
+			_hash ^= _keys->rotation(dir_index(_neighbor_dirs[0])) ^ _keys->rotation(dir_index(_neighbor_dirs[1]));
+
 		auto temp = _neighbor_dirs[0];
 		_neighbor_dirs[0] = _neighbor_dirs[1];
 		_neighbor_dirs[1] = _neighbor_dirs[2];
@@ -78,11 +258,37 @@ public:
 		_neighbor_dirs[3] = temp;
 	}
 
+	// Zobrist hash of the body, the item and the rotation of the neighbour directions
+	std::uint64_t hash() const {
+		return _hash;
+	}
+
+	// Cache of the moves chosen by the alternative-path fallback of the autopilot, keyed by hash()
+	const TranspositionCache<TileT>& transpositions() const {
+		return _fallbackMoves;
+	}
+
+	Fallback fallback() const {
+		return _fallback;
+	}
+
+	// Chooses the fallback of the autopilot (forgets the moves cached by the previous one)
+	void set_fallback(Fallback fallback) {
+		if (fallback != _fallback)
+			_fallbackMoves.clear();
+		_fallback = fallback;
+	}
+
+	// Restarts the generator of items from a seed
+	void seed(std::uint64_t seed) {
+		_generator.seed(seed);
+	}
+
 	// Finds new random position for _item
-	IntT generate_item() {
-		IntT item;
+	TileT generate_item() {
+		TileT item;
 		do {
-			item = _distribution(_generator);
+			item = random_below(_generator, _size * _size);
 		} while (contains(_snake, item) || !is_inside(item));
 
 		return item;
@@ -93,8 +299,13 @@ public:
 		return _gameOver;
 	}
 
+	// Ends the game
+	void set_game_over() {
+		_gameOver = true;
+	}
+
 	// Returns _ reference
-	VecIntT const& path() const {
+	Tiles const& path() const {
 		return _path;
 	}
 
@@ -103,148 +314,625 @@ public:
 		return _path.empty();
 	}
 
+	// Appends a tile to _path
+	void push_path(TileT tile) {
+		_path.push_back(tile);
+	}
+
+	// Tiles the head of _snake can move to without losing
+	BasicNeighbours<TileT> moves() const {
+		return neighbours(head(_snake), _snake);
+	}
+
 	// tile is inside the board (valid tile for the snake)
 	bool is_inside(IntT tile) const {
-		return ((tile > _size) && (tile < _size * (_size - 1)) && (tile % _size != 0) && (tile % _size != _size - 1));
+		return _graph && _graph->playable(tile);
+	}
+
+	// The head of _snake can move to new_head without losing (into a free tile or the tile its tail is leaving)
+	bool can_move(IntT new_head) const {
+		return is_inside(new_head) && (!contains(_snake, new_head) || tail(_snake) == new_head);
 	}
 
 	// Checks if snake contains a tile (a part of its body lies on a tile)
-	bool contains(const VecIntT& snake, IntT tile) const {
+	bool contains(std::span<const TileT> snake, IntT tile) const {
 		return std::find(snake.begin(), snake.end(), tile) != snake.end();
 	}
 
 	// Moves a snake on a path. If consumed_item, the snake becomes longer. If cut_first, the first element on path doesn't count.
-	VecIntT shift(const VecIntT& path, const VecIntT& snake, const bool consumed_item, const bool cut_first) const {
-		VecIntT concatenatedVector(path.begin() + cut_first, path.end());
-		std::reverse(concatenatedVector.begin(), concatenatedVector.end());
-		concatenatedVector.insert(concatenatedVector.end(), snake.begin(), snake.end());
-		concatenatedVector.resize(snake.size() + consumed_item);
-		return concatenatedVector;
+	template <typename Vec = Tiles>
+	Vec shift(std::span<const TileT> path, std::span<const TileT> snake, const bool consumed_item, const bool cut_first,
+		typename Vec::allocator_type allocator = {}) const {
+		Vec shifted(allocator);
+		shift_into(shifted, path, snake, consumed_item, cut_first);
+		return shifted;
 	}
 
 	// Moves a snake by one element (path). If consumed_item, the snake becomes longer.
-	VecIntT shift(IntT path, const VecIntT& snake, const bool consumed) const {
-		return shift(VecIntT(1, path), snake, consumed, false);
+	template <typename Vec = Tiles>
+	Vec shift(TileT path, std::span<const TileT> snake, const bool consumed, typename Vec::allocator_type allocator = {}) const {
+		return shift<Vec>(std::span<const TileT>(&path, 1), snake, consumed, false, allocator);
 	}
 
-	// Moves _snake by one tile according to _path
-	bool shift_snake() {
+	// Number of tiles the snake can occupy (the snake of this length has won)
+	IntT playable_tiles() const {
+		return _graph ? _graph->playable_tiles() : 0;
+	}
 
-		_snake = shift(_path[0], _snake, _path.size() == 1 && _toItem);
+	// The snake covers every playable tile
+	bool won() const {
+		return snake_length() == playable_tiles();
+	}
 
-		_path.erase(_path.begin());
+	// Moves the head of _snake to new_head. If it is the _item, the snake becomes longer and a new _item is generated
+	// (or the game is won). Returns true if the item was consumed.
+	bool move_head(TileT new_head) {
+		const bool consumed = is_item(new_head);
+		const size_t length = _snake.size();
+		const TileT old_head = head(_snake);
 
-		if (!_gameOver && _path.empty() && _toItem) {
-			_item = generate_item();
-			return true;
+		// The old head becomes a segment, the tail leaves its tile unless the snake grows
+		if (_keys) {
+			_hash ^= _keys->head(old_head) ^ _keys->head(new_head);
+			if (consumed || length > 1)
+				_hash ^= _keys->segment(old_head, dir_index(new_head - old_head));
+			if (!consumed && length > 1)
+				_hash ^= _keys->segment(_snake[length - 1], dir_index(_snake[length - 2] - _snake[length - 1]));
 		}
-		return false;
+
+		// The tail frees its tile (unless the snake grows), the head takes one
+		if (_itemCount > 1) {
+			if (!consumed)
+				_free.add(tail(_snake));
+			_free.remove(new_head);
+		}
+
+		// Shift in place, so that _snake keeps its memory
+		if (consumed)
+			_snake.push_back(tail(_snake));
+		std::shift_right(_snake.begin(), _snake.end(), 1);
+		_snake.front() = new_head;
+
+		if (!_path.empty() && _path.front() == new_head)
+			_path.erase(_path.begin());
+		if (!_escape.empty())
+			follow_escape(new_head, consumed);
+
+		if (consumed) {
+			if (won())
+				_gameOver = true;
+			else if (_itemCount > 1)
+				replace_item(new_head);
+			else
+				set_item(generate_item());
+		}
+		return consumed;
+	}
+
+	// Moves _snake by one tile according to _path. Returns true if a new item was generated
+	bool shift_snake() {
+		return move_head(_path.front()) && !_gameOver;
+	}
+
+	// Captures the current state of the game
+	Snapshot snapshot() const {
+		std::ostringstream generator;
+		generator << _generator;
+		return { _size, _neighbor_dirs, _snake, _item, _path, cycle1, cycle2, _toItem, _gameOver, generator.str(), _itemCount,
+			_extraItems, _graph };
+	}
+
+	// Resumes the game from a state captured by snapshot()
+	void restore(const Snapshot& s) {
+		_size = s.size;
+		_graph = s.graph && s.graph->size() == _size ? s.graph : BoardGraph::rectangular(_size - 2);
+		_neighbor_dirs = s.neighbor_dirs;
+		_snake = s.snake;
+		std::istringstream generator(s.generator);
+		generator >> _generator;
+		_item = s.item;
+		_path = s.path;
+		cycle1 = s.cycle1;
+		cycle2 = s.cycle2;
+		_toItem = s.toItem;
+		_gameOver = s.gameOver;
+		_itemCount = s.itemCount;
+		_extraItems = s.extraItems;
+		_escape.clear();
+		_seenStates.clear();
+		_fallbackMoves.clear();					// Boards of the same size share keys, the moves may be for another graph
+		rebuild_free_cells();
+		_keys = ZobristKeys::for_tiles(_size * _size);
+		rehash();
+		reserve_autopilot();
+	}
+
+	// Captures the state of the autopilot (replays record it after every decision)
+	PilotState pilot_state() const {
+		return { cycle1, cycle2, (IntT)dir_index(_neighbor_dirs[0]), _toItem };
+	}
+
+	// Sets the state of the autopilot and the path it follows, as captured by pilot_state() and path()
+	void set_pilot_state(const PilotState& s, std::span<const TileT> path) {
+		cycle1 = s.cycle1;
+		cycle2 = s.cycle2;
+		for (int r = 0; r < 4 && (IntT)dir_index(_neighbor_dirs[0]) != s.rotation; ++r)
+			shift_neighbors();
+		_toItem = s.toItem;
+		_path.assign(path.begin(), path.end());
 	}
 
 	// Auto-pilot algorithm
 	void autoPilotStep() {
+		const auto kept = kept_capacities();
+		plan();
+		_scratch.reset();
+		_stepAllocations = _scratch.last_allocations();
+		for (auto& scratch : _candidateScratch) {
+			scratch.reset();
+			_stepAllocations += scratch.last_allocations();
+		}
+
+		// A container kept between steps that grew allocated at least once
+		const auto now = kept_capacities();
+		for (size_t i = 0; i < kept.size(); ++i)
+			_stepAllocations += kept[i] != now[i];
+	}
+
+	// Auto-pilot step that returns around deadline, with a move that keeps the tail within reach if it runs out of time
+	void autoPilotStep(Clock::time_point deadline) {
+		_deadline = deadline;
+		++_timedSteps;
+		autoPilotStep();
+		_deadline = Clock::time_point::max();
+	}
+
+	// Smallest free area (playable tiles not covered by the snake) whose searches run level by level on the thread pool
+	IntT parallel_search_tiles() const {
+		return _parallelSearchTiles;
+	}
 
-		VecIntT path;
-		shift_neighbors();
+	void set_parallel_search_tiles(IntT tiles) {
+		_parallelSearchTiles = tiles;
+	}
+
+	// Steps with a deadline so far
+	size_t timed_steps() const {
+		return _timedSteps;
+	}
+
+	// Steps with a deadline that ran out of time and took the safe move
+	size_t deadline_hits() const {
+		return _deadlineHits;
+	}
+
+	// Heap allocations made by the last autopilot step: by its scratch arenas and by the containers it keeps between steps
+	// (zero once the arenas have grown enough)
+	size_t scratch_allocations() const {
+		return _stepAllocations;
+	}
+
+
+private:
+	#pragma region Fields
+	IntT _size = 0;								// Dimension of the square board
+	std::shared_ptr<const BoardGraph> _graph;	// Playable tiles (walls and obstacles excluded)
+	std::array<int, 4> _neighbor_dirs{0,0,0,0};			// Neighboring tiles (up, down, left, right)
+	Tiles _snake;								// Body of snake
+	RandomT _generator;							// Generator of the items
+	TileT _item = 0;							// Item that makes the snake grow
+	IntT _itemCount = 1;						// Items on the board at the same time
+	Tiles _extraItems;							// Items besides _item (with _itemCount > 1)
+	FreeCells _free;							// Tiles with neither a segment nor an item (with _itemCount > 1)
+	Tiles _path;									// A vector of tiles that the snake follows
+	IntT cycle1 = 0;							// First cycle for chcecking if the snake gets stuck in a loop
+	IntT cycle2 = 0;							// Second cycle for chcecking if the snake gets stuck in a loop
+	bool _toItem = false;						// The goal of the current path of the snake is the item
+	bool _gameOver = false;						// The snake either won or lost
+	ScratchArena _scratch;				// Memory for temporaries of the current autopilot step
+	std::array<ScratchArena, 4> _candidateScratch;	// Memory for searching from each neighbour of the head
+	DistanceField<TileT> _itemField;			// Distances to the nearest item over the playable tiles (without the body)
+	std::shared_ptr<const ZobristKeys> _keys;	// Keys of _hash
+	std::uint64_t _hash = 0;					// Zobrist hash of the body, the item and the rotation of _neighbor_dirs
+	StateSet _seenStates;						// States (with cycle1) the autopilot decided in since its last path to the item
+	TranspositionCache<TileT> _fallbackMoves;	// Moves chosen by the alternative-path fallback (-1 if there was none)
+	Fallback _fallback = Fallback::LongestPath;
+	PilotSettings _pilot;
+	Clock::time_point _deadline = Clock::time_point::max();	// Deadline of the current step (max if it has none)
+	TileT _safeMove = -1;						// Move the current step takes if it runs out of time
+	TileT _firstMove = -1;						// First move of the head (taken if no move was found safe in time)
+	Tiles _escape;								// Tiles the snake can follow for good (see set_escape(), kept in timed steps)
+	size_t _escapeNext = 0;						// Index of the next tile of _escape
+	size_t _escapeLoop = 0;						// Index _escape goes round to after its last tile
+	size_t _timedSteps = 0;
+	size_t _deadlineHits = 0;
+	size_t _stepAllocations = 0;				// Heap allocations of the last autopilot step (see scratch_allocations())
+	#pragma endregion
+
+	static constexpr IntT parallelFallbackTiles = 24 * 24;	// Smallest board whose fallback searches run in parallel
+	static constexpr size_t parallelSearchChunk = 1024;		// Frontier tiles a task of the parallel search expands
+	static constexpr size_t timedChunk = 16384;				// Tiles a search fills or visits between two looks at the clock
+	IntT _parallelSearchTiles = 64 * 64;		// Smallest free area searched in parallel (see parallel_search())
+
+	// Sizes the containers the autopilot keeps between steps for the whole board, so its steps don't grow them. Only
+	// _seenStates can outgrow it (more decisions than tiles without reaching an item)
+	void reserve_autopilot() {
+		const IntT tiles = playable_tiles();
+		_path.reserve(tiles);
+		_escape.reserve(3 * tiles);				// A prefix, a path to the tail and the body
+		_seenStates.reserve(tiles);
+		_fallbackMoves.reserve();
+		_itemField.reserve(_graph->tiles());
+	}
+
+	// Capacities of the containers reserve_autopilot() sizes
+	std::array<size_t, 5> kept_capacities() const {
+		return { _path.capacity(), _escape.capacity(), _seenStates.capacity(), _fallbackMoves.capacity(), _itemField.capacity() };
+	}
+
+	// Finds the next path for the snake (body of autoPilotStep). All temporaries are allocated from _scratch
+	void plan() {
+		auto memory = _scratch.resource();
+		ScratchTiles path(memory);
+		for (int r = 0; r < _pilot.rotation; ++r)
+			shift_neighbors();
+
+		// The same decision was already made since the last path to the item, the snake would go round in a loop - LOSE
+		if (!_seenStates.insert(state_key())) {
+			_gameOver = true;
+			return;
+		}
+
+		// A step with a deadline has a safe move from the start
+		if (timed())
+			_safeMove = safe_move(memory);
+		if (expired())
+			return take_safe_move();
 
 		// Find item
-		if (!(path = BFS(head(_snake), _item, _snake, false, true)).empty()) {
+		if (!(path = item_path(memory)).empty()) {
 
 			// Is going to eat the last item - WIN
-			if ((IntT)_snake.size() + 1 == (_size * _size - 4 * (_size - 1))) {
-				_path = path;
+			if ((IntT)_snake.size() + 1 == playable_tiles()) {
+				_path.assign(path.begin(), path.end());
 				_toItem = true;
 				_gameOver = true;
+				_seenStates.clear();
 				return;
 			}
 
-			auto shifted_snake = shift(path, _snake, true, false);
+			auto shifted_snake = shift<ScratchTiles>(path, _snake, true, false, memory);
 
 			// Look for tail to check if path is safe
-			if (!BFS(head(shifted_snake), tail(shifted_snake), shifted_snake, false, true).empty())
+			if (auto to_tail = BFS(head(shifted_snake), tail(shifted_snake), shifted_snake, false, true, memory); !to_tail.empty())
 			{
-				_path = path;
+				_path.assign(path.begin(), path.end());
 				_toItem = true;
+				if (timed())
+					set_escape(path, to_tail, shifted_snake, memory);
 
 				// Set cycles to zero
 				cycle1 = 0;
 				cycle2 = 0;
+				_seenStates.clear();
 				return;
 			}
 		}
+		if (expired())
+			return take_safe_move();
 
 		// Find tail
-		if (cycle1 < (IntT)_snake.size() && !(path = BFS(head(_snake), tail(_snake), _snake, true, true)).empty()) {
+		if (cycle1 < _pilot.tailChase * _snake.size() && !(path = BFS(head(_snake), tail(_snake), _snake, true, true, memory)).empty()) {
 			_path.push_back(path.front());
 			_toItem = false;
+			if (timed())
+				set_escape({}, path, _snake, memory);
 			++cycle1;
 			return;
 		}
+		if (expired())
+			return take_safe_move();
 
 		// Too many cycles - LOSE
-		if (cycle2 > (IntT)_snake.size() * 3) {
+		if (cycle2 > _pilot.giveUp * _snake.size()) {
 			_gameOver = true;
 			return;
 		}
 
 		#pragma region Find alternative path to tail
-		// Find different (longer) path to tail
-		std::vector<VecIntT> paths;
-		for (auto n : neighbours(head(_snake), _snake)) {
-			if (n == _item) {
-				paths.push_back(VecIntT());
-				continue;
-			}
-
-			auto snake = shift(n, _snake, false);
-			if (!(path = BFS(head(snake), tail(snake), snake, false, false)).empty()) {
-				paths.push_back(path);
-			}
-			else {
-				paths.push_back(VecIntT());
+		// Find different (longer) path to tail. The choice depends only on the state, so it is cached by its hash
+		TileT move;
+		if (auto cached = _fallbackMoves.find(_hash))
+			move = *cached;
+		else {
+			move = _fallback == Fallback::FloodFill ? roomiest_move(memory) : longest_path_move();
+			if (expired()) {
+				// Without a safe move, the best move of the searches that finished is better than none
+				if (_safeMove < 0)
+					_safeMove = move;
+				return take_safe_move();
 			}
+			_fallbackMoves.store(_hash, move);
 		}
 
 		// No paths from head to tail - LOSE
-		if (paths.empty()) {
+		if (move < 0) {
 			_gameOver = true;
 			return;
 		}
 
-		// Find longest path
-		auto it = std::max_element(paths.begin(), paths.end(),
-			[](const auto& a, const auto& b) {
-				return a.size() < b.size();
-			});
-
-		// Take the first tile of the longest path
-		_path.push_back(paths[std::distance(paths.begin(), it)].front());
+		_path.push_back(move);
+		if (timed() && move != escape_move()) {
+			auto snake = shift<ScratchTiles>(move, _snake, is_item(move), memory);
+			if (auto to_tail = BFS(head(snake), tail(snake), snake, false, true, memory); !to_tail.empty())
+				set_escape(std::span<const TileT>(&move, 1), to_tail, snake, memory);
+			else
+				_escape.clear();
+		}
 
 		++cycle2;
 		_toItem = false;
 		#pragma endregion
 	}
 
+	// Neighbour of the head with the longest path to the tail, or -1 if there is none
+	TileT longest_path_move() {
+		const auto candidates = neighbours(head(_snake), _snake);
+		if (candidates.empty())
+			return -1;
 
-private:
-	#pragma region Fields
-	IntT _size = 0;								// Dimension of the square board
-	std::array<int, 4> _neighbor_dirs{0,0,0,0};			// Neighboring tiles (up, down, left, right)
-	VecIntT _snake;								// Body of snake
-	std::default_random_engine _generator;		// Generator of random integers [0 - _size*_size)
-	std::uniform_int_distribution<IntT> _distribution;		// Uniform integer distribution
-	IntT _item = 0;								// Item that makes the snake grow
-	VecIntT _path;									// A vector of tiles that the snake follows
-	IntT cycle1 = 0;							// First cycle for chcecking if the snake gets stuck in a loop
-	IntT cycle2 = 0;							// Second cycle for chcecking if the snake gets stuck in a loop
-	bool _toItem = false;						// The goal of the current path of the snake is the item
-	bool _gameOver = false;						// The snake either won or lost
-	#pragma endregion
+		// Length of the path to tail through each neighbour (0 if there is none). Every neighbour has its own scratch arena,
+		// so on large boards they are searched concurrently
+		std::array<size_t, 4> lengths{};
+		auto evaluate = [&](size_t i) {
+			if (is_item(candidates[i]))
+				return;
+
+			auto memory = _candidateScratch[i].resource();
+			auto snake = shift<ScratchTiles>(candidates[i], _snake, false, memory);
+			lengths[i] = BFS(head(snake), tail(snake), snake, false, false, memory).size();
+		};
+
+		if (playable_tiles() >= parallelFallbackTiles)
+			ThreadPool::shared().parallel_for(candidates.size(), evaluate);
+		else {
+			for (size_t i = 0; i < candidates.size(); ++i)
+				evaluate(i);
+		}
+
+		// Take the first tile of the longest path (the neighbour itself)
+		auto it = std::max_element(lengths.begin(), lengths.begin() + candidates.size());
+		return *it > 0 ? candidates[std::distance(lengths.begin(), it)] : -1;
+	}
+
+	// The current step has a deadline
+	bool timed() const {
+		return _deadline != Clock::time_point::max();
+	}
+
+	// The current step has a deadline that has passed
+	bool expired() const {
+		return timed() && Clock::now() >= _deadline;
+	}
+
+	// Move that keeps the tail within reach for good: the next tile of _escape, otherwise the first neighbour of the head
+	// from which BFS reaches the tail (which becomes the new _escape). -1 if none was found before the deadline
+	TileT safe_move(std::pmr::memory_resource* memory) {
+		if (const TileT move = escape_move(); move >= 0)
+			return move;
+
+		_escape.clear();
+		const auto candidates = neighbours(head(_snake), _snake);
+		_firstMove = candidates.empty() ? -1 : candidates[0];
+		for (auto candidate : candidates) {
+			if (expired())
+				break;
+
+			auto snake = shift<ScratchTiles>(candidate, _snake, is_item(candidate), memory);
+			auto to_tail = BFS(head(snake), tail(snake), snake, false, true, memory);
+			if (!to_tail.empty() && set_escape(std::span<const TileT>(&candidate, 1), to_tail, snake, memory))
+				return candidate;
+		}
+		return -1;
+	}
+
+	// Remembers prefix, to_tail and snake (tail to head) as the loop _escape. Returns false (and forgets it) if to_tail crosses snake
+	bool set_escape(std::span<const TileT> prefix, std::span<const TileT> to_tail, std::span<const TileT> snake,
+		std::pmr::memory_resource* memory) {
+		ScratchTiles body(snake.begin(), snake.end() - 1, memory);
+		std::sort(body.begin(), body.end());
+		for (auto tile : to_tail.first(to_tail.size() - 1)) {
+			if (std::binary_search(body.begin(), body.end(), tile)) {
+				_escape.clear();
+				return false;
+			}
+		}
+
+		_escape.assign(prefix.begin(), prefix.end());
+		_escapeLoop = _escape.size();
+		_escape.insert(_escape.end(), to_tail.begin(), to_tail.end());
+		for (IntT i = (IntT)snake.size() - 2; i >= 0; --i)
+			_escape.push_back(snake[i]);
+		_escapeNext = 0;
+		return true;
+	}
+
+	// Next tile of _escape if the head can move there now (-1 if there is none)
+	TileT escape_move() const {
+		if (_escape.empty())
+			return -1;
+		const TileT move = _escape[_escapeNext];
+		return can_move(move) && (!is_item(move) || _escapeNext + 1 == _escapeLoop) ? move : -1;
+	}
+
+	// The head moved to new_head (and ate if consumed): advances along _escape, or forgets it if the move left it or the
+	// meal made the snake too long for it
+	void follow_escape(TileT new_head, bool consumed) {
+		const size_t at = _escapeNext;
+		if (new_head != _escape[at]) {
+			_escape.clear();
+			return;
+		}
+		_escapeNext = at + 1 == _escape.size() ? _escapeLoop : at + 1;
+		if (consumed && (at + 1 < _escapeLoop || _escape.size() - _escapeLoop < _snake.size()))
+			_escape.clear();
+	}
+
+	// State the autopilot records before every decision (the hash with cycle1, see plan())
+	std::uint64_t state_key() const {
+		return _hash ^ ZobristKeys::mix(cycle1 + 1);
+	}
+
+	// Ends a step that ran out of time with _safeMove (its state is forgotten, the move counts as an alternative one)
+	void take_safe_move() {
+		++_deadlineHits;
+		_seenStates.erase(state_key());
+		if (_safeMove < 0)
+			_safeMove = _firstMove;
+		if (_safeMove < 0 || ++cycle2 > _pilot.giveUp * _snake.size()) {
+			_gameOver = true;
+			return;
+		}
+		_path.push_back(_safeMove);
+		_toItem = false;
+
+		// Eating the item starts the counting over, like a path to the item
+		if (is_item(_safeMove)) {
+			cycle1 = 0;
+			cycle2 = 0;
+			_seenStates.clear();
+		}
+	}
+
+	// Neighbour of the head with the largest free region from which the tail can be reached, or -1 if there is none
+	TileT roomiest_move(std::pmr::memory_resource* memory) {
+		const auto candidates = neighbours(head(_snake), _snake);
+		TileT best = -1;
+		std::tuple<bool, IntT, IntT> bestScore(false, -1, -1);
+
+		ScratchTiles snake(memory);
+		ScratchTiles queue(memory);
+		std::pmr::vector<IntT> distance(memory);
+		for (auto candidate : candidates) {
+			if (is_item(candidate))
+				continue;
+			if (expired())
+				break;
+
+			shift_into(snake, std::span<const TileT>(&candidate, 1), _snake, false, false);
+			auto [area, toTail] = flood_fill(snake, distance, queue);
+			if (expired())
+				break;
+			std::tuple<bool, IntT, IntT> score(toTail > 0, area, toTail);
+			if (score > bestScore) {
+				bestScore = score;
+				best = candidate;
+			}
+		}
+		return best;
+	}
+
+	// Free region the head of snake can reach and its distance to the tail (0 if unreachable), partial if the step expires
+	std::pair<IntT, IntT> flood_fill(std::span<const TileT> snake, std::pmr::vector<IntT>& distance, ScratchTiles& queue) const {
+		const IntT blocked = -2, unseen = -1;
+		distance.assign(_size * _size, unseen);
+		for (size_t i = 0; i + (snake.size() > 2) < snake.size(); ++i)
+			distance[snake[i]] = blocked;
+
+		const TileT to = tail(snake);
+		IntT area = 0, toTail = 0;
+		queue.assign(1, head(snake));
+		distance[head(snake)] = 0;
+		for (size_t i = 0; i < queue.size(); ++i) {
+			if (i % timedChunk == timedChunk - 1 && expired())
+				break;
+			const TileT tile = queue[i];
+			if (tile == to)
+				toTail = distance[tile];
+
+			for (auto n : _graph->neighbours(tile)) {
+				if (distance[n] == unseen) {
+					distance[n] = distance[tile] + 1;
+					queue.push_back(n);
+					++area;
+				}
+			}
+		}
+		return { area, toTail };
+	}
+
+	// Index (0-3) of a neighbour offset in the order up, down, left, right
+	size_t dir_index(IntT offset) const {
+		return offset == -_size ? 0 : offset == _size ? 1 : offset == -1 ? 2 : 3;
+	}
+
+	// Computes _hash from scratch
+	void rehash() {
+		_hash = 0;
+		if (!_keys || _snake.empty())
+			return;
+
+		_hash ^= _keys->head(_snake[0]) ^ _keys->item(_item) ^ _keys->rotation(dir_index(_neighbor_dirs[0]));
+		for (auto item : _extraItems)
+			_hash ^= _keys->item(item);
+		for (size_t i = 1; i < _snake.size(); ++i)
+			_hash ^= _keys->segment(_snake[i], dir_index(_snake[i - 1] - _snake[i]));
+	}
+
+	// Fills _free with the tiles that have neither a segment nor an item (only used with more than one item)
+	void rebuild_free_cells() {
+		if (_itemCount <= 1) {
+			_free.clear();
+			return;
+		}
+
+		_free.reset(_size * _size);
+		for (IntT tile = 0; tile < _size * _size; ++tile) {
+			if (is_inside(tile) && !is_item(tile))
+				_free.add(tile);
+		}
+		for (auto segment : _snake)
+			_free.remove(segment);
+	}
+
+	// Removes a random free tile from _free and returns it
+	TileT take_free_cell() {
+		const IntT n = random_below(_generator, _free.size());
+		const TileT tile = _free.nth(n);
+		_free.remove(tile);
+		return tile;
+	}
+
+	// Replaces the eaten item with a new one from the free cells. Without a free cell, the item is gone (an extra item
+	// takes the place of _item)
+	void replace_item(TileT eaten) {
+		const TileT next = _free.empty() ? -1 : take_free_cell();
+		if (_keys)
+			_hash ^= _keys->item(eaten) ^ (next >= 0 ? _keys->item(next) : 0);
+
+		if (eaten == _item) {
+			if (next >= 0)
+				_item = next;
+			else {
+				_item = _extraItems.back();
+				_extraItems.pop_back();
+			}
+			return;
+		}
+
+		auto it = std::find(_extraItems.begin(), _extraItems.end(), eaten);
+		if (next >= 0)
+			*it = next;
+		else
+			_extraItems.erase(it);
+	}
 
 	// Initialize the snake with length len
-	VecIntT init_snake(IntT len) const {
-		VecIntT body;
+	Tiles init_snake(IntT len) const {
+		Tiles body;
 		IntT current_tile = (_size / 2) * _size + (_size / 2);
+		for (IntT i = 0; i < _size * _size && !is_inside(current_tile); ++i)
+			current_tile = (current_tile + 1) % (_size * _size);
 
 		for (auto i : { 3, 1, 2, 0, 3 }) {
 			while (is_inside(current_tile) && !contains(body, current_tile) && len > 0) {
@@ -261,45 +949,269 @@ private:
 		return body;
 	}
 
-	// Find all neighbours of tile with the current snake position (tiles part of its body do not count)
-	VecIntT neighbours(IntT tile, const VecIntT& snake) const {
-		VecIntT tile_neighbours;
-		for (auto n : _neighbor_dirs) {
-			if (is_inside(tile + n) && (!contains(snake, tile + n) || (tail(snake) == tile + n && snake.size() > 2)))
-				tile_neighbours.push_back(tile + n);
+	// Fills result with the snake shifted on a path (see shift())
+	template <typename Vec>
+	void shift_into(Vec& result, std::span<const TileT> path, std::span<const TileT> snake, const bool consumed_item, const bool cut_first) const {
+		const size_t length = snake.size() + consumed_item;
+		result.assign(path.rbegin(), path.rend() - cut_first);
+		if (result.size() < length)
+			result.insert(result.end(), snake.begin(), snake.begin() + std::min(snake.size(), length - result.size()));
+		result.resize(length);
+	}
+
+	// Find all neighbours of tile with the current snake position (tiles part of its body do not count). They come from
+	// the graph in the order of _neighbor_dirs: the directions from the first one on, then the ones before it
+	BasicNeighbours<TileT> neighbours(IntT tile, std::span<const TileT> snake) const {
+		BasicNeighbours<TileT> tile_neighbours;
+		const auto tiles = _graph->neighbours(tile);
+		const auto dirs = _graph->directions(tile);
+		const size_t first = dir_index(_neighbor_dirs[0]);
+
+		for (int pass = 0; pass < 2; ++pass) {
+			for (size_t i = 0; i < tiles.size(); ++i) {
+				const IntT n = tiles[i];
+				if ((dirs[i] >= first) == (pass == 0) && (!contains(snake, n) || (tail(snake) == n && snake.size() > 2)))
+					tile_neighbours.push_back(n);
+			}
 		}
 		return tile_neighbours;
 	}
 
-	// Looks for the shortest path from a tile (from) to a tile (to) with the current snake position. Can avoid item if necessary
-	VecIntT BFS(const IntT from, const IntT to, const VecIntT& snake, const bool avoid_item, const bool cut_first) {
-		VecIntT path;
-		path.push_back(from);
+	// Shortest path from the head to the nearest item (without the head), read from _itemField if the body allows it
+	ScratchTiles item_path(std::pmr::memory_resource* memory) {
+		ScratchTiles path(memory);
+		// The field is left invalid (and the path empty) when the step runs out of time while searching it
+		if (!_itemField.valid_for(_graph, _item, _extraItems) &&
+			!_itemField.compute(_graph, _item, _extraItems, [this] { return expired(); }))
+			return path;
+		if (follow_item_field(path, memory) || expired())
+			return path;
+		return parallel_search(head(_snake), [this](IntT tile) { return is_item(tile); }, _snake, false, true, memory);
+	}
 
-		std::set<IntT> visited;
-		std::queue<VecIntT> queue;
+	// Looks for the shortest path from a tile (from) to a tile (to) with the current snake position. Can avoid item if necessary.
+	// The path and all temporaries are allocated from memory
+	ScratchTiles BFS(const TileT from, const TileT to, std::span<const TileT> snake, const bool avoid_item, const bool cut_first,
+		std::pmr::memory_resource* memory) const {
+		return search(from, [to](IntT tile) { return tile == to; }, snake, avoid_item, cut_first, memory);
+	}
+
+	// Walks _itemField downhill from the head around the body (the path BFS() finds). Returns false if it gets nowhere
+	bool follow_item_field(ScratchTiles& path, std::pmr::memory_resource* memory) const {
+		const IntT length = _snake.size();
+		TileT tile = head(_snake);
+		if (_itemField[tile] == _itemField.unreachable)
+			return false;
+
+		// First segment on every tile (length if there is none)
+		std::pmr::vector<IntT> segment(_size * _size, length, memory);
+		for (IntT i = length - 1; i >= 0; --i)
+			segment[_snake[i]] = i;
+
+		std::pmr::vector<char> dead(memory);			// Tiles no walk got on from (filled at the first dead end)
+		std::pmr::vector<std::uint8_t> tried(1, 0, memory);	// Neighbours tried from the tile at each step of path
+		for (size_t visited = 0; _itemField[tile] > 0; ++visited) {
+			// Out of time (the caller sees expired() too)
+			if (visited % timedChunk == 0 && expired()) {
+				path.clear();
+				return false;
+			}
+
+			// After path.size() moves, the segments up to the tail (segment length - moves - 1) still lie on their tiles,
+			// and the tail can be entered if length > 2, as in neighbours()
+			const IntT tail = length - (IntT)path.size() - 1;
+			auto is_free = [&](IntT n) {
+				return segment[n] > tail || (segment[n] == tail && length > 2);
+			};
+
+			const auto candidates = neighbours(tile, {});
+			TileT next = -1;
+			while (next < 0 && tried.back() < candidates.size()) {
+				const TileT n = candidates[tried.back()++];
+				if (_itemField[n] == _itemField[tile] - 1 && (dead.empty() || !dead[n]) && is_free(n))
+					next = n;
+			}
+
+			if (next >= 0) {
+				path.push_back(next);
+				tried.push_back(0);
+				tile = next;
+				continue;
+			}
+			if (path.empty())
+				return false;
+			if (dead.empty())
+				dead.resize(_size * _size, false);
+			dead[tile] = true;
+			path.pop_back();
+			tried.pop_back();
+			tile = path.empty() ? head(_snake) : path.back();
+		}
+		return true;
+	}
+
+	// Breadth first search like BFS() for the nearest tile that is_target (so one search can look for several targets)
+	template <typename Target>
+	ScratchTiles search(const TileT from, Target&& is_target, std::span<const TileT> snake, const bool avoid_item,
+		const bool cut_first, std::pmr::memory_resource* memory) const {
+		if (playable_tiles() - (IntT)snake.size() >= _parallelSearchTiles)
+			return parallel_search(from, is_target, snake, avoid_item, cut_first, memory);
+
+		ScratchTiles path(1, from, memory);
+		ScratchTiles shifted(memory);
+
+		std::pmr::set<TileT> visited(memory);
+		std::queue<ScratchTiles, std::pmr::deque<ScratchTiles>> queue(memory);
 		visited.insert(from);
 		queue.push(path);
 
-		while (!queue.empty()) {
-			path = queue.front();
+		for (size_t expanded = 1; !queue.empty(); ++expanded) {
+			// Out of time (the caller sees expired() too). Every expansion shifts the body, so the clock is read often
+			if (expanded % 16 == 0 && expired())
+				break;
+
+			path = std::move(queue.front());
 			queue.pop();
-			if (path.back() == to) {
+			if (is_target(path.back())) {
 				if (cut_first)
 					path.erase(path.begin());
 				return path;
 			}
 
-			for (auto n : neighbours(path.back(), shift(path, snake, false, true))) {
-				if (!visited.contains(n) && (!avoid_item || n != _item)) {
+			shift_into(shifted, path, snake, false, true);
+			for (auto n : neighbours(path.back(), shifted)) {
+				if (!visited.contains(n) && (!avoid_item || !is_item(n))) {
 					visited.insert(n);
-					auto p = VecIntT(path);
+					ScratchTiles p(path, memory);
 					p.push_back(n);
-					queue.push(p);
+					queue.push(std::move(p));
 				}
 			}
 		}
 
-		return VecIntT();
+		return ScratchTiles(memory);
+	}
+
+	// search() for huge boards: expands every level in parallel and returns the same path
+	template <typename Target>
+	ScratchTiles parallel_search(const TileT from, Target&& is_target, std::span<const TileT> snake, const bool avoid_item,
+		const bool cut_first, std::pmr::memory_resource* memory) const {
+		const IntT tiles = _size * _size;
+		const IntT length = snake.size();
+		const size_t first = dir_index(_neighbor_dirs[0]);
+		const std::array<IntT, 4> offsets{ -_size, _size, -1, 1 };
+
+		// Per-tile arrays, filled a part at a time so an expired step stops in between. claim holds the smallest (frontier
+		// index, direction) that reached a tile (accessed atomically)
+		constexpr std::uint64_t unclaimed = std::numeric_limits<std::uint64_t>::max();
+		std::pmr::vector<IntT> segment(memory);
+		std::pmr::vector<char> seen(memory);
+		std::pmr::vector<std::uint64_t> claim(memory);
+		auto grow = [&](auto& v, auto value) {
+			v.reserve(tiles);
+			for (IntT done = 0; done < tiles; done += timedChunk) {
+				if (expired())
+					return false;
+				v.resize(std::min<IntT>(tiles, done + timedChunk), value);
+			}
+			return true;
+		};
+		if (!grow(segment, length) || !grow(seen, char(false)) || !grow(claim, unclaimed))
+			return ScratchTiles(memory);
+		auto key = [&](IntT tile) {
+			return std::atomic_ref<std::uint64_t>(claim[tile]).load(std::memory_order_relaxed);
+		};
+
+		// After some moves, the body covers the segments before length - moves and the tail (the last of them) can be
+		// entered if length > 2, as in neighbours()
+		for (IntT i = length - 1; i >= 0; --i)
+			segment[snake[i]] = i;
+		auto blocked = [&](IntT tile, IntT moves) {
+			const IntT i = segment[tile], tail = length - moves - 1;
+			return i <= tail && !(length > 2 && snake[tail] == tile);
+		};
+
+		ScratchTiles frontier(1, from, memory);
+		ScratchTiles next(memory);
+		// Tiles claimed in a level: every task has room for 4 claims per frontier tile it expands, so the workers never
+		// allocate (the arena isn't thread-safe)
+		constexpr size_t taskClaims = parallelSearchChunk * 4;
+		std::pmr::vector<std::pair<std::uint64_t, TileT>> reached(memory);
+		std::pmr::vector<size_t> claimed(memory);	// Claims each task made
+		seen[from] = true;
+		TileT target = is_target(from) ? from : -1;
+
+		for (IntT moves = 0; target < 0 && !frontier.empty(); ++moves) {
+			if (expired())
+				return ScratchTiles(memory);
+
+			// Every task claims the neighbours of its part of the frontier
+			const size_t tasks = (frontier.size() + parallelSearchChunk - 1) / parallelSearchChunk;
+			reached.resize(tasks * taskClaims);
+			claimed.assign(tasks, 0);
+			ThreadPool::shared().parallel_for(tasks, [&](size_t task) {
+				auto* out = reached.data() + task * taskClaims;
+				size_t count = 0;
+				const size_t end = std::min(frontier.size(), (task + 1) * parallelSearchChunk);
+				for (size_t f = task * parallelSearchChunk; f < end; ++f) {
+					const auto neighbours = _graph->neighbours(frontier[f]);
+					const auto dirs = _graph->directions(frontier[f]);
+					for (size_t i = 0; i < neighbours.size(); ++i) {
+						const IntT n = neighbours[i];
+						if (seen[n] || blocked(n, moves) || (avoid_item && is_item(n)))
+							continue;
+
+						// Rank of the direction in the rotated order of _neighbor_dirs
+						const std::uint64_t mine = f * 4 + (dirs[i] + 4 - first) % 4;
+						std::atomic_ref<std::uint64_t> c(claim[n]);
+						std::uint64_t current = c.load(std::memory_order_relaxed);
+						while (mine < current && !c.compare_exchange_weak(current, mine, std::memory_order_relaxed)) {}
+						if (mine < current)
+							out[count++] = { mine, n };
+					}
+				}
+				claimed[task] = count;
+			});
+
+			// The next level holds every tile by its smallest claim, in the order of the claims
+			next.clear();
+			for (size_t task = 0; task < tasks; ++task) {
+				for (auto [k, n] : std::span(reached.data() + task * taskClaims, claimed[task])) {
+					if (key(n) == k && !seen[n]) {
+						seen[n] = true;
+						next.push_back(n);
+					}
+				}
+			}
+			std::sort(next.begin(), next.end(), [&](TileT a, TileT b) {
+				return key(a) < key(b);
+			});
+			for (auto n : next) {
+				if (is_target(n)) {
+					target = n;
+					break;
+				}
+			}
+			std::swap(frontier, next);
+		}
+		if (target < 0)
+			return ScratchTiles(memory);
+
+		ScratchTiles path(memory);
+		for (TileT tile = target; tile != from; tile = tile - offsets[(key(tile) % 4 + first) % 4])
+			path.push_back(tile);
+		if (!cut_first)
+			path.push_back(from);
+		std::reverse(path.begin(), path.end());
+		return path;
 	}
 };
+
+using Board = BasicBoard<IntT>;
+using CompactBoard = BasicBoard<std::int16_t>;				// For boards whose tiles (with the wall) fit in 16 bits
+
+
+// Every tile of a board of dimension dim (with the wall) fits in a 16-bit index
+constexpr bool fits_compact_tiles(IntT dim) {
+	return (dim + 2) * (dim + 2) <= INT16_MAX;
+}
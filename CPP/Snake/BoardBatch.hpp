@@ -0,0 +1,218 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Board.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// BoardBatch steps many independent games of the same board
+/// size in lockstep, like a vectorized environment. The games are
+/// stored as a structure of arrays (heads, lengths, items, bodies
+/// as ring buffers, occupancy bitboards) and every step runs as
+/// a few passes over all of them. The passes that decide the
+/// outcomes and move the bodies are branch-free (dead games are
+/// masked out, the rings wrap around by masks instead of %); only
+/// restarting a game and drawing a new item branch, for the games
+/// that need it. Games follow the rules of Board: they start as
+/// Board(dim, length, seed) and the items come from the same
+/// generator, so a game gives the same result as Board::can_move()
+/// / Board::move_head() on one board.
+////////////////////////////////////////////////////////////
+class BoardBatch {
+public:
+	// Actions, in the order of the neighbour offsets of Board
+	enum Action : std::uint8_t { Up, Down, Left, Right };
+
+	// What the last step did to a game (Done: the game was already over, only without resetOnDone)
+	enum Outcome : std::uint8_t { Moved, Ate, Died, Won, Done };
+
+	// Plays games from seeds firstSeed, firstSeed + 1, ... If resetOnDone, a game that is over starts again
+	// with the next unused seed in the following step, otherwise it ignores further actions (and reports Done)
+	BoardBatch(size_t games, IntT dim, IntT startingLength, unsigned firstSeed, bool resetOnDone = true)
+		: _games(games), _size(dim + 2), _tiles(_size * _size),
+		_words((_tiles + 63) / 64), _offsets{ -_size, _size, -1, 1 }, _resetOnDone(resetOnDone), _nextSeed(firstSeed),
+		_heads(games), _lengths(games), _items(games), _ringHead(games), _bodies(games * _tiles),
+		_occupancy(games * _words), _generators(games), _newHeads(games), _outcomes(games, Moved), _done(games, 0),
+		_seeds(games), _wall(_tiles) {
+
+		// Every game starts with the body of this board (which doesn't depend on the seed)
+		Board board(dim, startingLength, 0);
+		for (IntT tile = 0; tile < _tiles; ++tile)
+			_wall[tile] = !board.is_inside(tile);
+		_playableTiles = board.playable_tiles();
+		_startingBody.assign(board.snake().begin(), board.snake().end());
+
+		for (size_t g = 0; g < _games; ++g)
+			reset(g);
+	}
+
+	size_t games() const {
+		return _games;
+	}
+
+	// Dimension of the boards (including the wall)
+	IntT size() const {
+		return _size;
+	}
+
+	IntT head(size_t game) const {
+		return _heads[game];
+	}
+
+	IntT length(size_t game) const {
+		return _lengths[game];
+	}
+
+	IntT item(size_t game) const {
+		return _items[game];
+	}
+
+	// Seed the game was started from
+	unsigned seed(size_t game) const {
+		return _seeds[game];
+	}
+
+	// Segment of the body of a game (0 is the head)
+	IntT segment(size_t game, IntT index) const {
+		return _bodies[game * _tiles + wrap(_ringHead[game] + index)];
+	}
+
+	// A part of the body of a game lies on tile
+	bool occupied(size_t game, IntT tile) const {
+		return (_occupancy[game * _words + tile / 64] >> (tile % 64)) & 1;
+	}
+
+	// What the last step did to every game
+	std::span<const Outcome> outcomes() const {
+		return _outcomes;
+	}
+
+	// Moves the head of every game in the direction of its action
+	void step(std::span<const Action> actions) {
+		const IntT* offsets = _offsets.data();
+		const IntT tiles = _tiles;
+
+		// Restart the games that ended in the previous step
+		for (size_t g = 0; g < _games; ++g) {
+			if (_done[g] && _resetOnDone)
+				reset(g);
+		}
+
+		// New heads
+		for (size_t g = 0; g < _games; ++g)
+			_newHeads[g] = _heads[g] + offsets[actions[g] & 3];
+
+		// Outcomes: a game dies by hitting the wall or its body (except the tile the tail is leaving), it eats the item.
+		// A game that is over stays Done
+		for (size_t g = 0; g < _games; ++g) {
+			const IntT h = _newHeads[g];
+			const IntT tail = _bodies[g * tiles + wrap(_ringHead[g] + _lengths[g] - 1)];
+			const IntT body = (_occupancy[g * _words + h / 64] >> (h % 64)) & 1;
+			const IntT done = _done[g];
+			const IntT died = _wall[h] | (body & (h != tail));
+			const IntT eats = (h == _items[g]) & !died;
+			_outcomes[g] = Outcome(Done * done + (1 - done) * (Died * died + Ate * eats));
+		}
+
+		// Move the bodies (a game that died or is over keeps its body: its writes are masked out)
+		for (size_t g = 0; g < _games; ++g) {
+			std::uint64_t* occupancy = &_occupancy[g * _words];
+			IntT* ring = &_bodies[g * tiles];
+			const IntT h = _newHeads[g];
+			const IntT live = _outcomes[g] < Died;
+			const IntT ate = _outcomes[g] == Ate;
+
+			// The tail leaves its tile unless the snake grows
+			const IntT tail = ring[wrap(_ringHead[g] + _lengths[g] - 1)];
+			occupancy[tail / 64] &= ~(std::uint64_t(live & !ate) << (tail % 64));
+			_lengths[g] += ate;
+
+			const IntT ringHead = _ringHead[g] - live;
+			_ringHead[g] = ringHead + (tiles & -(ringHead < 0));
+			ring[_ringHead[g]] = live ? h : ring[_ringHead[g]];
+			occupancy[h / 64] |= std::uint64_t(live) << (h % 64);
+			_heads[g] = live ? h : _heads[g];
+			_done[g] |= !live;
+		}
+
+		// New items for the games that ate
+		for (size_t g = 0; g < _games; ++g) {
+			if (_outcomes[g] != Ate)
+				continue;
+
+			if (_lengths[g] == _playableTiles) {
+				_outcomes[g] = Won;
+				_done[g] = 1;
+			}
+			else
+				_items[g] = generate_item(g);
+		}
+	}
+
+private:
+	size_t _games;
+	IntT _size;									// Dimension including the wall
+	IntT _tiles;
+	IntT _words;								// 64-bit words of an occupancy bitboard
+	IntT _playableTiles = 0;					// Length of a snake that has won
+	std::array<IntT, 4> _offsets;				// Neighbouring tiles (up, down, left, right)
+	bool _resetOnDone;
+	unsigned _nextSeed;
+
+	// One element (or block of _tiles / _words elements) per game
+	std::vector<IntT> _heads;
+	std::vector<IntT> _lengths;
+	std::vector<IntT> _items;
+	std::vector<IntT> _ringHead;				// Position of the head in the ring buffer of the body
+	std::vector<IntT> _bodies;					// Ring buffers of the bodies, the body runs forward from the head
+	std::vector<std::uint64_t> _occupancy;		// Bitboards of the bodies
+	std::vector<Board::Random> _generators;
+	std::vector<IntT> _newHeads;
+	std::vector<Outcome> _outcomes;
+	std::vector<std::uint8_t> _done;
+	std::vector<unsigned> _seeds;
+
+	std::vector<std::uint8_t> _wall;			// Tiles outside the playable area
+	std::vector<IntT> _startingBody;			// Body every game starts with
+
+	// Index into a ring buffer of _tiles elements (index < 2 * _tiles)
+	IntT wrap(IntT index) const {
+		return index - (_tiles & -(index >= _tiles));
+	}
+
+	// Starts a game again, as Board(dim, startingLength, seed) would with the next seed
+	void reset(size_t g) {
+		_seeds[g] = _nextSeed++;
+		_generators[g].seed(_seeds[g]);
+
+		std::fill_n(&_occupancy[g * _words], _words, 0);
+		_ringHead[g] = 0;
+		_lengths[g] = _startingBody.size();
+		for (IntT i = 0; i < _lengths[g]; ++i) {
+			const IntT tile = _startingBody[i];
+			_bodies[g * _tiles + i] = tile;
+			_occupancy[g * _words + tile / 64] |= std::uint64_t(1) << (tile % 64);
+		}
+		_heads[g] = _startingBody[0];
+		_items[g] = generate_item(g);
+		_done[g] = 0;
+	}
+
+	// Finds new random position for the item of a game (the same way as Board::generate_item())
+	IntT generate_item(size_t g) {
+		IntT item;
+		do {
+			item = random_below(_generators[g], _tiles);
+		} while (_wall[item] || occupied(g, item));
+		return item;
+	}
+};
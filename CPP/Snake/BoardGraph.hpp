@@ -0,0 +1,141 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// BoardGraph holds the playable tiles of a square board and their
+/// adjacency as a compressed sparse row graph: the neighbours of
+/// every tile lie next to each other in one array, in the order
+/// up, down, left, right. Wall and obstacle tiles are not playable
+/// and have no neighbours. A graph is immutable, so boards share it.
+///
+/// Map files have one line per row of the playable area: '#' is an
+/// obstacle, any other character a free tile. The board gets a wall
+/// around the map (and around the shorter rows of a map that is not
+/// square).
+////////////////////////////////////////////////////////////
+class BoardGraph {
+public:
+	// Square board of dimension dim surrounded by a wall
+	explicit BoardGraph(int dim) : BoardGraph(dim + 2, rectangle(dim + 2)) {}
+
+	// Board of dimension size (including the wall) whose playable tiles are marked in playable
+	BoardGraph(int size, std::vector<char> playable) : _size(size), _playable(std::move(playable)), _offsets(1, 0) {
+		const int dirs[4] = { -_size, _size, -1, 1 };
+		for (int tile = 0; tile < tiles(); ++tile) {
+			if (_playable[tile]) {
+				++_playableTiles;
+				for (std::uint8_t d = 0; d < 4; ++d) {
+					const int n = tile + dirs[d];
+					if (playable_tile(n)) {
+						_neighbours.push_back(n);
+						_directions.push_back(d);
+					}
+				}
+			}
+			_offsets.push_back(_neighbours.size());
+		}
+	}
+
+	// Graph of a board of dimension dim without obstacles (shared by all boards of that dimension)
+	static std::shared_ptr<const BoardGraph> rectangular(int dim) {
+		static std::mutex mutex;
+		static std::map<int, std::shared_ptr<const BoardGraph>> graphs;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& g = graphs[dim];
+		if (!g)
+			g = std::make_shared<const BoardGraph>(dim);
+		return g;
+	}
+
+	// Graph of a map file, or nullptr if it can't be read or has no free tile
+	static std::shared_ptr<const BoardGraph> load(const std::string& file) {
+		std::ifstream in(file);
+		if (!in)
+			return nullptr;
+
+		std::vector<std::string> rows;
+		size_t dim = 0;
+		for (std::string line; std::getline(in, line);) {
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			rows.push_back(line);
+			dim = std::max(dim, line.size());
+		}
+		dim = std::max(dim, rows.size());
+
+		const int size = dim + 2;
+		std::vector<char> playable(size * size, false);
+		bool any = false;
+		for (size_t r = 0; r < rows.size(); ++r) {
+			for (size_t c = 0; c < rows[r].size(); ++c) {
+				playable[(r + 1) * size + c + 1] = rows[r][c] != '#';
+				any |= rows[r][c] != '#';
+			}
+		}
+		return any ? std::make_shared<const BoardGraph>(size, std::move(playable)) : nullptr;
+	}
+
+	// Dimension of the board (including the wall)
+	int size() const {
+		return _size;
+	}
+
+	int tiles() const {
+		return _size * _size;
+	}
+
+	// Number of tiles the snake can occupy
+	int playable_tiles() const {
+		return _playableTiles;
+	}
+
+	// tile is on the board and the snake can enter it
+	bool playable(int tile) const {
+		return playable_tile(tile);
+	}
+
+	// Playable neighbours of tile in the order up, down, left, right
+	std::span<const int> neighbours(int tile) const {
+		return { _neighbours.data() + _offsets[tile], _neighbours.data() + _offsets[tile + 1] };
+	}
+
+	// Direction (0 up, 1 down, 2 left, 3 right) of each of neighbours(tile)
+	std::span<const std::uint8_t> directions(int tile) const {
+		return { _directions.data() + _offsets[tile], _directions.data() + _offsets[tile + 1] };
+	}
+
+private:
+	int _size = 0;
+	std::vector<char> _playable;				// Playable flag of every tile
+	int _playableTiles = 0;
+	std::vector<int> _offsets;					// Neighbours of tile t are _neighbours[_offsets[t] .. _offsets[t + 1])
+	std::vector<int> _neighbours;
+	std::vector<std::uint8_t> _directions;		// Direction of every entry of _neighbours
+
+	bool playable_tile(int tile) const {
+		return tile >= 0 && tile < tiles() && _playable[tile];
+	}
+
+	// Playable flags of a board of dimension size with only the outer wall
+	static std::vector<char> rectangle(int size) {
+		std::vector<char> playable(size * size, false);
+		for (int tile = 0; tile < size * size; ++tile)
+			playable[tile] = tile > size && tile < size * (size - 1) && tile % size != 0 && tile % size != size - 1;
+		return playable;
+	}
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "BoardGraph.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// DistanceField holds the distance of every playable tile of a
+/// board graph to the nearest of some target tiles (one breadth
+/// first search from all of them). It leaves the snake out, so it
+/// only has to be searched again when a target moves; a walk along
+/// it checks the body itself (see BasicBoard::item_path()). The
+/// field is a cache: a copy starts out invalid.
+////////////////////////////////////////////////////////////
+template <typename TileT>
+class DistanceField {
+public:
+	static constexpr TileT unreachable = std::numeric_limits<TileT>::max();
+
+	DistanceField() {}
+
+	DistanceField(const DistanceField&) {}
+
+	DistanceField& operator=(const DistanceField&) {
+		invalidate();
+		return *this;
+	}
+
+	// The field holds distances to target and extra_targets on graph
+	bool valid_for(const std::shared_ptr<const BoardGraph>& graph, TileT target, std::span<const TileT> extra_targets) const {
+		return _graph && _graph == graph && !_targets.empty() && _targets[0] == target &&
+			std::equal(_targets.begin() + 1, _targets.end(), extra_targets.begin(), extra_targets.end());
+	}
+
+	// Forces the next valid_for() to fail
+	void invalidate() {
+		_graph.reset();
+	}
+
+	// Distance of tile to the nearest target (unreachable if there is none or tile isn't playable)
+	TileT operator[](TileT tile) const {
+		return _distance[tile];
+	}
+
+	// Allocates room for a graph of that many tiles now instead of in compute()
+	void reserve(size_t tiles) {
+		_distance.reserve(tiles);
+		_queue.reserve(tiles);
+	}
+
+	// Room of the field (it changes when compute() allocates)
+	size_t capacity() const {
+		return _targets.capacity() + _distance.capacity() + _queue.capacity();
+	}
+
+	// Searches graph from target and extra_targets
+	void compute(std::shared_ptr<const BoardGraph> graph, TileT target, std::span<const TileT> extra_targets) {
+		compute(std::move(graph), target, extra_targets, [] { return false; });
+	}
+
+	// compute() that gives up (and leaves the field invalid) as soon as stop() returns true. stop is called every
+	// stopInterval tiles. Returns false if it gave up
+	template <typename Stop>
+	bool compute(std::shared_ptr<const BoardGraph> graph, TileT target, std::span<const TileT> extra_targets, Stop&& stop) {
+		invalidate();
+		_targets.assign(1, target);
+		_targets.insert(_targets.end(), extra_targets.begin(), extra_targets.end());
+		_distance.assign(graph->tiles(), unreachable);
+		if (stop())
+			return false;
+
+		_queue.clear();
+		for (auto t : _targets) {
+			if (_distance[t] == unreachable) {
+				_distance[t] = 0;
+				_queue.push_back(t);
+			}
+		}
+		for (size_t i = 0; i < _queue.size(); ++i) {
+			if (i % stopInterval == stopInterval - 1 && stop())
+				return false;
+			const TileT tile = _queue[i];
+			for (auto n : graph->neighbours(tile)) {
+				if (_distance[n] == unreachable) {
+					_distance[n] = _distance[tile] + 1;
+					_queue.push_back(n);
+				}
+			}
+		}
+		_graph = std::move(graph);
+		return true;
+	}
+
+private:
+	static constexpr size_t stopInterval = 16384;	// Tiles searched between two calls of stop
+
+	std::shared_ptr<const BoardGraph> _graph;	// Graph the field was searched on (null while invalid)
+	std::vector<TileT> _targets;				// Tiles the field was searched from (the item first)
+	std::vector<TileT> _distance;				// Distance of every tile to the nearest target
+	std::vector<TileT> _queue;					// Queue of the search (reused)
+};
@@ -0,0 +1,51 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// Generates EmbeddedAssets.hpp, which compiles the game assets
+/// into the executable. Build the game with SNAKE_EMBEDDED_ASSETS
+/// defined to load them from there instead of the disk.
+///
+/// Usage: EmbedAssets [resources dir] [output header]
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    const std::string resources = argc > 1 ? argv[1] : "resources/";
+    const std::string output = argc > 2 ? argv[2] : "EmbeddedAssets.hpp";
+    const std::vector<std::string> files = { "item.wav", "snake.png", "tile.png", "tuffy.ttf" };
+
+    std::ofstream header(output);
+    header << "#pragma once\n\n"
+        "// Generated by EmbedAssets from " << resources << ", do not edit\n\n"
+        "#include <span>\n#include <string>\n\n";
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::ifstream file(resources + files[i], std::ios::binary);
+        if (!file) {
+            std::cerr << "Can't open " << resources + files[i] << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        header << "// " << files[i] << "\ninline const unsigned char embeddedAsset" << i << "[] = {";
+        for (size_t b = 0; b < data.size(); ++b)
+            header << (b % 16 ? " " : "\n    ") << static_cast<int>(data[b]) << ",";
+        header << "\n};\n\n";
+    }
+
+    header << "// Returns the contents of an embedded asset file (empty if there is none)\n"
+        "inline std::span<const unsigned char> embeddedAsset(const std::string& file) {\n";
+    for (size_t i = 0; i < files.size(); ++i)
+        header << "    if (file == \"" << files[i] << "\")\n        return embeddedAsset" << i << ";\n";
+    header << "    return {};\n}\n";
+
+    return header ? EXIT_SUCCESS : EXIT_FAILURE;
+}
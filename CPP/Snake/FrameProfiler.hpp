@@ -0,0 +1,185 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// FrameProfiler splits every frame into phases (event handling,
+/// taking the snapshot of the game, drawing, display) and keeps
+/// the timings of the last frames, the number of draw calls, the
+/// time the simulation thread worked during them and the latency of
+/// the recent planner decisions. Every frame can also be
+/// written as a row of a CSV file. While neither the overlay nor the
+/// CSV file is on, the profiler doesn't read the clock at all.
+////////////////////////////////////////////////////////////
+class FrameProfiler {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum Phase { Events, Snapshot, Drawing, Display, phaseCount };
+
+	static constexpr size_t frameHistory = 120;		// Frames the rolling averages are taken over
+	static constexpr size_t plannerHistory = 256;	// Planner decisions the percentiles are taken over
+
+	~FrameProfiler() {
+		close_csv();
+	}
+
+	bool visible() const {
+		return _visible;
+	}
+
+	void set_visible(bool visible) {
+		if (!enabled())
+			_phaseStart = Clock::now();
+		_visible = visible;
+	}
+
+	// The profiler measures (the overlay is shown or the CSV file is open)
+	bool enabled() const {
+		return _visible || _csv.is_open();
+	}
+
+	// Starts writing one row per frame to file
+	bool open_csv(const std::string& file) {
+		close_csv();
+		if (!enabled())
+			_phaseStart = Clock::now();
+		_csv.open(file);
+		if (!_csv)
+			return false;
+		_csv << "frame,events_us,snapshot_us,drawing_us,display_us,frame_us,draw_calls,planner_us,simulation_us\n";
+		return true;
+	}
+
+	void close_csv() {
+		if (_csv.is_open())
+			_csv.close();
+	}
+
+	bool csv_open() const {
+		return _csv.is_open();
+	}
+
+	// Starts a frame, the first phase starts now
+	void begin_frame() {
+		_current = {};
+		if (enabled())
+			_phaseStart = Clock::now();
+	}
+
+	// Ends the current phase, the next one starts now
+	void end_phase(Phase phase) {
+		if (!enabled())
+			return;
+		const auto now = Clock::now();
+		_current.phase[phase] += micros(now - _phaseStart);
+		_phaseStart = now;
+	}
+
+	// Counts a draw call of the current frame
+	void count_draw() {
+		++_current.drawCalls;
+	}
+
+	// Counts a planner decision of us microseconds (timed by the thread that made it) in the current frame
+	void add_planner(float us) {
+		if (!enabled())
+			return;
+		_current.planner += us;
+		_planner[_plannerCount++ % plannerHistory] = us;
+	}
+
+	// Counts us microseconds the simulation thread worked (timed by it) in the current frame. The simulation runs beside
+	// the frame, so it is not part of the frame time
+	void add_simulation(float us) {
+		if (enabled())
+			_current.simulation += us;
+	}
+
+	// Ends the frame, stores it and writes it to the CSV file
+	void end_frame() {
+		++_frames;
+		if (!enabled())
+			return;
+
+		for (auto us : _current.phase)
+			_current.total += us;
+		_history[_historyCount++ % frameHistory] = _current;
+
+		if (_csv.is_open()) {
+			_csv << _frames;
+			for (auto us : _current.phase)
+				_csv << ',' << us;
+			_csv << ',' << _current.total << ',' << _current.drawCalls << ',' << _current.planner << ',' << _current.simulation << '\n';
+		}
+	}
+
+	// Text of the overlay: rolling frame and phase times, draw calls, simulation time and planner latency percentiles
+	std::string summary() const {
+		const size_t frames = std::min(_historyCount, frameHistory);
+		if (frames == 0)
+			return "";
+
+		Frame mean{};
+		float worst = 0;
+		for (size_t i = 0; i < frames; ++i) {
+			for (size_t p = 0; p < phaseCount; ++p)
+				mean.phase[p] += _history[i].phase[p] / frames;
+			mean.total += _history[i].total / frames;
+			mean.simulation += _history[i].simulation / frames;
+			worst = std::max(worst, _history[i].total);
+		}
+		const Frame& last = _history[(_historyCount - 1) % frameHistory];
+
+		char text[512];
+		int length = std::snprintf(text, sizeof(text),
+			"frame   %6.2f ms (max %.2f, %.0f fps)\nevents  %6.2f ms\nsnapshot%6.2f ms\ndraw    %6.2f ms (%d calls)\ndisplay %6.2f ms\nsim     %6.2f ms (other thread)\n",
+			mean.total / 1000, worst / 1000, mean.total > 0 ? 1e6 / mean.total : 0.0, mean.phase[Events] / 1000,
+			mean.phase[Snapshot] / 1000, mean.phase[Drawing] / 1000, last.drawCalls, mean.phase[Display] / 1000,
+			mean.simulation / 1000);
+
+		const size_t decisions = std::min(_plannerCount, plannerHistory);
+		if (decisions > 0) {
+			std::vector<float> sorted(_planner.begin(), _planner.begin() + decisions);
+			std::sort(sorted.begin(), sorted.end());
+			auto percentile = [&](double p) { return sorted[std::min(decisions - 1, size_t(p * decisions))]; };
+			std::snprintf(text + length, sizeof(text) - length, "planner p50 %.0f us, p95 %.0f us, p99 %.0f us",
+				percentile(0.5), percentile(0.95), percentile(0.99));
+		}
+		return text;
+	}
+
+private:
+	struct Frame {
+		std::array<float, phaseCount> phase{};	// Microseconds per phase
+		float total = 0;
+		float planner = 0;						// Microseconds spent in planner decisions
+		float simulation = 0;					// Microseconds the simulation thread worked
+		int drawCalls = 0;
+	};
+
+	bool _visible = false;
+	std::ofstream _csv;
+	unsigned long long _frames = 0;
+	Clock::time_point _phaseStart;
+	Frame _current;
+	std::array<Frame, frameHistory> _history{};	// Ring buffer of the last frames
+	size_t _historyCount = 0;
+	std::array<float, plannerHistory> _planner{};	// Ring buffer of the last planner latencies
+	size_t _plannerCount = 0;
+
+	static float micros(Clock::duration d) {
+		return std::chrono::duration<float, std::micro>(d).count();
+	}
+};
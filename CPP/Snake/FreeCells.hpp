@@ -0,0 +1,83 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <bit>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// FreeCells is the set of free tiles of a board, kept as a
+/// Fenwick tree of counts over the tiles. Adding and removing a
+/// tile and finding the n-th free tile (in the order of the tiles)
+/// take logarithmic time. The n-th tile doesn't depend on the order
+/// the tiles were added in, so a random free tile drawn from a
+/// seeded generator is the same after the board is restored.
+////////////////////////////////////////////////////////////
+class FreeCells {
+public:
+	// Empties the set and sizes it for tiles [0, tiles)
+	void reset(int tiles) {
+		_free.assign(tiles, false);
+		_tree.assign(tiles + 1, 0);
+		_count = 0;
+	}
+
+	void clear() {
+		_free.clear();
+		_tree.clear();
+		_count = 0;
+	}
+
+	int size() const {
+		return _count;
+	}
+
+	bool empty() const {
+		return _count == 0;
+	}
+
+	bool contains(int tile) const {
+		return tile >= 0 && tile < (int)_free.size() && _free[tile];
+	}
+
+	void add(int tile) {
+		if (_free[tile])
+			return;
+		_free[tile] = true;
+		++_count;
+		update(tile, 1);
+	}
+
+	void remove(int tile) {
+		if (!_free[tile])
+			return;
+		_free[tile] = false;
+		--_count;
+		update(tile, -1);
+	}
+
+	// Free tile with n free tiles before it (0 <= n < size())
+	int nth(int n) const {
+		int position = 0;
+		for (int step = std::bit_floor(_tree.size() - 1); step > 0; step /= 2) {
+			if (position + step < (int)_tree.size() && _tree[position + step] <= n) {
+				position += step;
+				n -= _tree[position];
+			}
+		}
+		return position;
+	}
+
+private:
+	std::vector<char> _free;					// Free flag of every tile
+	std::vector<int> _tree;						// Fenwick tree of the flags (1-based)
+	int _count = 0;
+
+	void update(int tile, int delta) {
+		for (int i = tile + 1; i < (int)_tree.size(); i += i & -i)
+			_tree[i] += delta;
+	}
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <climits>
+
+#include "Board.hpp"
+#include "SharedBoard.hpp"
+#include "Strategy.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// Result of a game played without a window
+////////////////////////////////////////////////////////////
+struct GameResult {
+	bool won = false;
+	IntT length = 0;							// Final length of the snake
+	IntT items = 0;								// Items eaten
+	long long moves = 0;						// Moves of the snake
+	long long decisions = 0;					// Decisions of the strategy
+	long long deadlineHits = 0;					// Decisions that ran out of their budget
+};
+
+
+// Plays the game on board with strategy until it is over (or maxMoves moves were made). With a budget, every
+// decision has a deadline that far in the future. With an exporter, the board is published after every move
+template <typename Strategy, typename TileT, typename RandomT>
+GameResult playGame(BasicBoard<TileT, RandomT>& board, PilotStrategy<Strategy>& strategy, long long maxMoves = LLONG_MAX,
+	std::chrono::microseconds budget = {}, SharedBoardWriter* exporter = nullptr) {
+	GameResult result;
+	const IntT startingLength = board.snake_length();
+	if (exporter)
+		exporter->publish(board, 0);
+
+	while (result.moves < maxMoves) {
+		// Find new path to follow
+		if (board.isPathEmpty()) {
+			if (board.gameOver())
+				break;
+			if (budget.count() > 0)
+				strategy.step(board, PilotStrategy<Strategy>::Clock::now() + budget);
+			else
+				strategy.step(board);
+			++result.decisions;
+		}
+
+		// If there is still path left, follow it
+		if (!board.isPathEmpty()) {
+			board.shift_snake();
+			++result.moves;
+			if (exporter)
+				exporter->publish(board, result.moves);
+		}
+	}
+
+	result.won = board.won();
+	result.length = board.snake_length();
+	result.items = result.length - startingLength;
+	result.deadlineHits = board.deadline_hits();
+	return result;
+}
+
+// Plays the game on board with the heuristic autopilot (see playGame())
+template <typename TileT, typename RandomT>
+GameResult playAutoPilot(BasicBoard<TileT, RandomT>& board, long long maxMoves = LLONG_MAX, std::chrono::microseconds budget = {}) {
+	HeuristicPilot pilot;
+	return playGame(board, pilot, maxMoves, budget);
+}
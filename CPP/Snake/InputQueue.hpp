@@ -0,0 +1,88 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+
+////////////////////////////////////////////////////////////
+/// InputQueue holds the last few commands (with the time they were
+/// given) until the game consumes them, one per tick. When the queue
+/// is full, new commands are dropped, so the game never runs more
+/// than capacity ticks behind the player. It also keeps statistics of
+/// the latency between giving a command and consuming it.
+////////////////////////////////////////////////////////////
+template <typename Command, size_t capacity = 3>
+class InputQueue {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Adds a command given at the time given (e.g. when its key event arrived). Returns false if the queue is full
+	bool push(Command command, Clock::time_point given) {
+		if (_count == capacity)
+			return false;
+		_entries[(_first + _count++) % capacity] = { command, given };
+		return true;
+	}
+
+	bool empty() const {
+		return _count == 0;
+	}
+
+	// Newest command in the queue (the queue is not empty)
+	Command back() const {
+		return _entries[(_first + _count - 1) % capacity].command;
+	}
+
+	// Removes the oldest command and counts its latency
+	Command pop() {
+		const Entry& entry = _entries[_first];
+		_first = (_first + 1) % capacity;
+		--_count;
+
+		const double ms = std::chrono::duration<double, std::milli>(Clock::now() - entry.given).count();
+		++_consumed;
+		_latencySum += ms;
+		_latencyMax = std::max(_latencyMax, ms);
+		return entry.command;
+	}
+
+	// Drops the queued commands and the statistics
+	void clear() {
+		_first = _count = 0;
+		_consumed = 0;
+		_latencySum = _latencyMax = 0;
+	}
+
+	// Commands consumed since the last clear()
+	size_t consumed() const {
+		return _consumed;
+	}
+
+	// Mean latency between giving and consuming a command in milliseconds
+	double mean_latency() const {
+		return _consumed ? _latencySum / _consumed : 0;
+	}
+
+	double max_latency() const {
+		return _latencyMax;
+	}
+
+private:
+	struct Entry {
+		Command command{};
+		Clock::time_point given;
+	};
+
+	std::array<Entry, capacity> _entries{};		// Ring buffer
+	size_t _first = 0;
+	size_t _count = 0;
+	size_t _consumed = 0;
+	double _latencySum = 0;
+	double _latencyMax = 0;
+};
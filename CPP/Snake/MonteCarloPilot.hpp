@@ -0,0 +1,283 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+
+#include "Board.hpp"
+#include "RunLengthBody.hpp"
+#include "Strategy.hpp"
+#include "ThreadPool.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// MonteCarloPilot is a search-based alternative to
+/// HeuristicPilot (Board::autoPilotStep()). For every move of the head it plays
+/// many randomized games from the position on the board and takes
+/// the move whose games survived and scored best on average. A
+/// rollout copies only the body and the items (not the board with
+/// its hash, caches and free cells) and draws new items from its
+/// own Xoshiro256 engine, which is cheap to seed per decision. The
+/// rollouts of a long snake keep the body as straight runs (see
+/// RunLengthBody.hpp), which it copies and moves in time and
+/// memory that depend on its turns instead of its length.
+////////////////////////////////////////////////////////////
+class MonteCarloPilot : public PilotStrategy<MonteCarloPilot> {
+public:
+	static constexpr const char* name = "mc";
+
+	struct Settings {
+		std::chrono::microseconds budget{ 20000 };		// Time for one decision
+		size_t maxRollouts = 4096;						// Rollouts per move after which the decision is made early
+		IntT depth = 128;								// Moves of a single rollout
+		double discount = 0.95;							// Value of an item eaten one move later relative to now
+		double greed = 0.5;								// Probability of a rollout moving towards the item when it can
+		IntT runLengthBody = 2048;						// Shortest snake whose rollouts play on a RunLengthBody
+	};
+
+	MonteCarloPilot() : MonteCarloPilot(Settings()) {}
+
+	explicit MonteCarloPilot(Settings settings, unsigned seed = 0) : _settings(settings), _seed(seed) {}
+
+	const Settings& settings() const {
+		return _settings;
+	}
+
+	// Chooses the next move of board within the budget of the settings
+	void decide(Board& board) {
+		decide(board, std::chrono::steady_clock::now() + _settings.budget);
+	}
+
+	// Chooses the next move of board by deadline and appends it to its path (or ends the game if there is none)
+	void decide(Board& board, Clock::time_point deadline) {
+		const auto moves = board.moves();
+		if (moves.empty()) {
+			board.set_game_over();
+			return;
+		}
+		if (moves.size() == 1) {
+			board.push_path(moves[0]);
+			return;
+		}
+
+		auto& pool = ThreadPool::shared();
+		_threads.resize(pool.concurrency());
+		++_decision;
+		const bool runs = board.snake_length() >= _settings.runLengthBody;
+		if (runs)
+			_runBody = RunLengthBody<IntT>(board.snake(), board.size());
+
+		// Every thread plays rounds of one rollout per move until the budget or the rollout limit is exhausted
+		pool.parallel_for(_threads.size(), [&](size_t t) {
+			auto& thread = _threads[t];
+			thread.stats.fill({});
+			thread.random.seed(_seed ^ (_decision * 0x9E3779B9u) ^ (t * 0x85EBCA6Bu));
+
+			const size_t rounds = (_settings.maxRollouts + _threads.size() - 1) / _threads.size();
+			for (size_t round = 0; round < rounds && std::chrono::steady_clock::now() < deadline; ++round) {
+				for (size_t m = 0; m < moves.size(); ++m) {
+					thread.stats[m].add(runs ? rollout(board, _runBody, moves[m], thread.runGame, thread.random)
+						: rollout(board, board.snake(), moves[m], thread.game, thread.random));
+				}
+			}
+		});
+
+		// Merge the statistics, the first of equally good moves wins
+		std::array<Stats, 4> stats{};
+		for (auto& thread : _threads) {
+			for (size_t m = 0; m < moves.size(); ++m)
+				stats[m].merge(thread.stats[m]);
+		}
+
+		size_t best = 0;
+		for (size_t m = 1; m < moves.size(); ++m) {
+			if (stats[m].mean() > stats[best].mean())
+				best = m;
+		}
+		board.push_path(moves[best]);
+	}
+
+private:
+	// Outcome of the rollouts of one move
+	struct Stats {
+		size_t rollouts = 0;
+		double score = 0;
+
+		void add(double value) {
+			++rollouts;
+			score += value;
+		}
+
+		void merge(const Stats& other) {
+			rollouts += other.rollouts;
+			score += other.score;
+		}
+
+		double mean() const {
+			return rollouts ? score / rollouts : -1;
+		}
+	};
+
+	// Position of a rollout: just what its moves follow the rules of Board::move_head() on. The body is a VecIntT or a
+	// RunLengthBody<IntT>
+	template <typename Body>
+	struct Game {
+		Body snake;
+		VecIntT items;
+	};
+
+	// State owned by one thread of the pool, reused between decisions so rollouts don't allocate
+	struct Thread {
+		Game<VecIntT> game;
+		Game<RunLengthBody<IntT>> runGame;
+		Xoshiro256 random;
+		std::array<Stats, 4> stats{};
+	};
+
+	Settings _settings;
+	unsigned _seed;
+	unsigned _decision = 0;
+	std::vector<Thread> _threads;
+	RunLengthBody<IntT> _runBody;				// Body of the board the rollouts of a long snake start from
+
+	// Plays a random game in game starting with move from the position of board (whose body is body). Returns the
+	// discounted number of items eaten, minus the discounted death if the snake died (a won game counts as every
+	// remaining item eaten at once)
+	template <typename Body>
+	double rollout(const Board& board, const Body& body, IntT move, Game<Body>& game, Xoshiro256& random) const {
+		const auto& graph = board.graph();
+		game.snake = body;
+		game.items.assign(1, board.item());
+		game.items.insert(game.items.end(), board.extra_items().begin(), board.extra_items().end());
+
+		double eaten = 0, value = 1;
+		for (IntT i = 0; i < _settings.depth; ++i, value *= _settings.discount) {
+			if (i > 0) {
+				const auto moves = legal_moves(graph, game.snake);
+				if (moves.empty())
+					return eaten - value;
+				move = pick(graph.size(), game, moves, random);
+			}
+
+			if (advance(graph, game, move, random)) {
+				if (length(game.snake) == graph.playable_tiles())
+					return eaten + value * (graph.playable_tiles() - board.snake_length());
+				eaten += value;
+			}
+		}
+		return eaten;
+	}
+
+	// Tiles the head of snake can move to without losing (like Board::moves())
+	template <typename Body>
+	static Neighbours legal_moves(const BoardGraph& graph, const Body& snake) {
+		Neighbours moves;
+		for (auto n : graph.neighbours(head(snake))) {
+			if (!contains(snake, n) || (n == tail(snake) && length(snake) > 2))
+				moves.push_back(n);
+		}
+		return moves;
+	}
+
+	// Moves the head of game to tile. An item eaten there grows the snake and moves to a random free tile (or is gone
+	// if there is none). Returns true if an item was eaten
+	template <typename Body>
+	static bool advance(const BoardGraph& graph, Game<Body>& game, IntT tile, Xoshiro256& random) {
+		auto& snake = game.snake;
+		const auto item = std::find(game.items.begin(), game.items.end(), tile);
+		const bool consumed = item != game.items.end();
+		move_head(snake, tile, consumed);
+		if (!consumed)
+			return false;
+
+		const IntT free = graph.playable_tiles() - length(snake) - ((IntT)game.items.size() - 1);
+		if (free <= 0) {
+			game.items.erase(item);
+			return true;
+		}
+		IntT next;
+		do {
+			next = random_below(random, graph.size() * graph.size());
+		} while (!graph.playable(next) || contains(snake, next) ||
+			std::find(game.items.begin(), game.items.end(), next) != game.items.end());
+		*item = next;
+		return true;
+	}
+
+	// Picks a random move, preferring the ones that get closer to the first item
+	template <typename Body>
+	IntT pick(IntT size, const Game<Body>& game, const Neighbours& moves, Xoshiro256& random) const {
+		if (!game.items.empty() && (random() >> 11) * 0x1.0p-53 < _settings.greed) {
+			const IntT item = game.items.front();
+			const IntT distance = manhattan(size, head(game.snake), item);
+			Neighbours closer;
+			for (auto m : moves) {
+				if (manhattan(size, m, item) < distance)
+					closer.push_back(m);
+			}
+			if (!closer.empty())
+				return closer[random_below(random, closer.size())];
+		}
+		return moves[random_below(random, moves.size())];
+	}
+
+	#pragma region Bodies of a rollout
+	static IntT head(const VecIntT& snake) {
+		return snake.front();
+	}
+
+	static IntT head(const RunLengthBody<IntT>& snake) {
+		return snake.head();
+	}
+
+	static IntT tail(const VecIntT& snake) {
+		return snake.back();
+	}
+
+	static IntT tail(const RunLengthBody<IntT>& snake) {
+		return snake.tail();
+	}
+
+	static IntT length(const VecIntT& snake) {
+		return snake.size();
+	}
+
+	static IntT length(const RunLengthBody<IntT>& snake) {
+		return snake.length();
+	}
+
+	static bool contains(const VecIntT& snake, IntT tile) {
+		return std::find(snake.begin(), snake.end(), tile) != snake.end();
+	}
+
+	static bool contains(const RunLengthBody<IntT>& snake, IntT tile) {
+		return snake.contains(tile);
+	}
+
+	// Moves the head to tile, the tail follows unless the snake grows
+	static void move_head(VecIntT& snake, IntT tile, bool grow) {
+		if (grow)
+			snake.push_back(snake.back());
+		std::shift_right(snake.begin(), snake.end(), 1);
+		snake.front() = tile;
+	}
+
+	static void move_head(RunLengthBody<IntT>& snake, IntT tile, bool grow) {
+		if (grow)
+			snake.push_head(tile);
+		else
+			snake.advance(tile);
+	}
+	#pragma endregion
+
+	// Manhattan distance of two tiles of a board of the given size
+	static IntT manhattan(IntT size, IntT a, IntT b) {
+		return std::abs(a % size - b % size) + std::abs(a / size - b / size);
+	}
+};
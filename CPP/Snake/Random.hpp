@@ -0,0 +1,161 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <random>
+
+
+////////////////////////////////////////////////////////////
+/// Random number engines for the item generators. Unlike the
+/// engines of <random>, their output is specified exactly, so a
+/// seed gives the same game with every compiler and standard
+/// library. Both are uniform random bit generators and can be
+/// written to and read from a stream (board snapshots store them
+/// as text).
+///
+/// Pcg32 is PCG-XSH-RR (64-bit state, 32-bit output), the engine
+/// of the boards. Xoshiro256 is xoshiro256** (256-bit state, 64-bit
+/// output), the engine of the Monte Carlo rollouts.
+////////////////////////////////////////////////////////////
+class Pcg32 {
+public:
+	using result_type = std::uint32_t;
+
+	explicit Pcg32(std::uint64_t seed = 0) {
+		this->seed(seed);
+	}
+
+	void seed(std::uint64_t seed) {
+		_state = 0;
+		(*this)();
+		_state += seed;
+		(*this)();
+	}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()() {
+		const std::uint64_t old = _state;
+		_state = old * multiplier + increment;
+		const auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+		const auto rotation = static_cast<std::uint32_t>(old >> 59);
+		return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+	}
+
+	friend bool operator==(const Pcg32&, const Pcg32&) = default;
+
+	friend std::ostream& operator<<(std::ostream& out, const Pcg32& pcg) {
+		return out << pcg._state;
+	}
+
+	friend std::istream& operator>>(std::istream& in, Pcg32& pcg) {
+		return in >> pcg._state;
+	}
+
+private:
+	static constexpr std::uint64_t multiplier = 6364136223846793005u;
+	static constexpr std::uint64_t increment = 1442695040888963407u;
+
+	std::uint64_t _state = 0;
+};
+
+
+class Xoshiro256 {
+public:
+	using result_type = std::uint64_t;
+
+	explicit Xoshiro256(std::uint64_t seed = 0) {
+		this->seed(seed);
+	}
+
+	// Fills the state with SplitMix64 from seed (never all zeros)
+	void seed(std::uint64_t seed) {
+		for (auto& word : _state) {
+			seed += 0x9E3779B97F4A7C15u;
+			std::uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	static constexpr result_type min() {
+		return 0;
+	}
+
+	static constexpr result_type max() {
+		return std::numeric_limits<result_type>::max();
+	}
+
+	result_type operator()() {
+		const std::uint64_t result = rotl(_state[1] * 5, 7) * 9;
+		const std::uint64_t t = _state[1] << 17;
+		_state[2] ^= _state[0];
+		_state[3] ^= _state[1];
+		_state[1] ^= _state[2];
+		_state[0] ^= _state[3];
+		_state[2] ^= t;
+		_state[3] = rotl(_state[3], 45);
+		return result;
+	}
+
+	friend bool operator==(const Xoshiro256&, const Xoshiro256&) = default;
+
+	friend std::ostream& operator<<(std::ostream& out, const Xoshiro256& x) {
+		return out << x._state[0] << ' ' << x._state[1] << ' ' << x._state[2] << ' ' << x._state[3];
+	}
+
+	friend std::istream& operator>>(std::istream& in, Xoshiro256& x) {
+		return in >> x._state[0] >> x._state[1] >> x._state[2] >> x._state[3];
+	}
+
+private:
+	std::uint64_t _state[4];
+
+	static std::uint64_t rotl(std::uint64_t x, int k) {
+		return (x << k) | (x >> (64 - k));
+	}
+};
+
+
+// Uniform random integer in [0, bound) (bound > 0). Engines whose results use all bits of 32 or more use Lemire's
+// multiply-shift method, which rejects (and so divides) only in rare cases and has no modulo bias; others fall back
+// to <random>
+template <typename Engine>
+std::uint32_t random_below(Engine& engine, std::uint32_t bound) {
+	using Result = typename Engine::result_type;
+	if constexpr (Engine::min() == 0 && Engine::max() == std::numeric_limits<Result>::max() &&
+		std::numeric_limits<Result>::digits >= 32) {
+		auto bits = [&] { return static_cast<std::uint32_t>(engine() >> (std::numeric_limits<Result>::digits - 32)); };
+		std::uint64_t product = std::uint64_t(bits()) * bound;
+		auto low = static_cast<std::uint32_t>(product);
+		if (low < bound) {
+			const std::uint32_t threshold = -bound % bound;
+			while (low < threshold) {
+				product = std::uint64_t(bits()) * bound;
+				low = static_cast<std::uint32_t>(product);
+			}
+		}
+		return static_cast<std::uint32_t>(product >> 32);
+	}
+	else
+		return std::uniform_int_distribution<std::uint32_t>(0, bound - 1)(engine);
+}
+
+// Seed for games that should differ from run to run
+inline std::uint64_t random_seed() {
+	std::random_device device;
+	return (std::uint64_t(device()) << 32) | device();
+}
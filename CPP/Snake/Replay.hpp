@@ -0,0 +1,453 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Board.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// Replay file layout (native byte order):
+///
+///   header    "SNKR", u32 version, i32 board size, u32 keyframe interval,
+///             size * size u8 playable flags
+///   records   'M' i32 new head                      - one per move
+///             'P' Board::PilotState, tiles path      - before the move that follows a decision of the autopilot
+///             'K' u64 move, Board::Snapshot          - every interval moves (and at move 0)
+///   index     'I' u64 moves, u64 count, count * (u64 move, u64 offset of 'K')
+///   trailer   u64 offset of 'I', "SNKI"
+///
+/// A viewer reads the index from the end of the file, restores the
+/// nearest preceding keyframe and replays at most interval moves.
+/// With the decisions, the autopilot can resume a seeked game and
+/// make the recorded moves, except that it forgets the states it
+/// has seen since the last item (so a game the recording ended in a
+/// loop goes on until the loop is caught again).
+////////////////////////////////////////////////////////////
+namespace replay {
+
+	constexpr char magic[4] = { 'S', 'N', 'K', 'R' };
+	constexpr char indexMagic[4] = { 'S', 'N', 'K', 'I' };
+	constexpr std::uint32_t version = 1;
+
+	// Appends raw bytes of a trivially copyable value
+	template <typename T>
+	void put(std::vector<char>& out, const T& value) {
+		const char* bytes = reinterpret_cast<const char*>(&value);
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	// Appends a length-prefixed vector of tiles
+	inline void put(std::vector<char>& out, const VecIntT& tiles) {
+		put(out, static_cast<std::uint32_t>(tiles.size()));
+		for (auto tile : tiles)
+			put(out, static_cast<std::int32_t>(tile));
+	}
+
+	// Reads raw bytes of a trivially copyable value
+	template <typename T>
+	bool get(std::istream& in, T& value) {
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+
+	// Reads a length-prefixed vector of tiles
+	inline bool get(std::istream& in, VecIntT& tiles) {
+		std::uint32_t count;
+		if (!get(in, count))
+			return false;
+		tiles.resize(count);
+		for (auto& tile : tiles) {
+			std::int32_t t;
+			if (!get(in, t))
+				return false;
+			tile = t;
+		}
+		return true;
+	}
+
+	// Serializes a Board::Snapshot
+	inline void put(std::vector<char>& out, const Board::Snapshot& s) {
+		put(out, static_cast<std::int32_t>(s.size));
+		for (auto dir : s.neighbor_dirs)
+			put(out, static_cast<std::int32_t>(dir));
+		put(out, s.snake);
+		put(out, static_cast<std::int32_t>(s.item));
+		put(out, s.path);
+		put(out, static_cast<std::int32_t>(s.cycle1));
+		put(out, static_cast<std::int32_t>(s.cycle2));
+		put(out, static_cast<std::uint8_t>(s.toItem));
+		put(out, static_cast<std::uint8_t>(s.gameOver));
+		put(out, static_cast<std::uint32_t>(s.generator.size()));
+		out.insert(out.end(), s.generator.begin(), s.generator.end());
+		put(out, static_cast<std::int32_t>(s.itemCount));
+		put(out, s.extraItems);
+	}
+
+	// Serializes a decision of the autopilot
+	inline void put(std::vector<char>& out, const Board::PilotState& s, const VecIntT& path) {
+		put(out, static_cast<std::int32_t>(s.cycle1));
+		put(out, static_cast<std::int32_t>(s.cycle2));
+		put(out, static_cast<std::uint8_t>(s.rotation));
+		put(out, static_cast<std::uint8_t>(s.toItem));
+		put(out, path);
+	}
+
+	// Deserializes a decision of the autopilot
+	inline bool get(std::istream& in, Board::PilotState& s, VecIntT& path) {
+		std::int32_t cycle1, cycle2;
+		std::uint8_t rotation, toItem;
+		if (!get(in, cycle1) || !get(in, cycle2) || !get(in, rotation) || !get(in, toItem) || !get(in, path))
+			return false;
+		s = { cycle1, cycle2, rotation, toItem != 0 };
+		return true;
+	}
+
+	// Deserializes a Board::Snapshot
+	inline bool get(std::istream& in, Board::Snapshot& s) {
+		std::int32_t size, item, cycle1, cycle2, itemCount;
+		std::uint8_t toItem, gameOver;
+		std::uint32_t length;
+
+		if (!get(in, size))
+			return false;
+		for (auto& dir : s.neighbor_dirs) {
+			std::int32_t d;
+			if (!get(in, d))
+				return false;
+			dir = d;
+		}
+		if (!get(in, s.snake) || !get(in, item) || !get(in, s.path) || !get(in, cycle1) || !get(in, cycle2) ||
+			!get(in, toItem) || !get(in, gameOver) || !get(in, length))
+			return false;
+
+		s.generator.resize(length);
+		if (!in.read(s.generator.data(), length))
+			return false;
+
+		if (!get(in, itemCount) || !get(in, s.extraItems))
+			return false;
+		s.itemCount = itemCount;
+
+		s.size = size;
+		s.item = item;
+		s.cycle1 = cycle1;
+		s.cycle2 = cycle2;
+		s.toItem = toItem;
+		s.gameOver = gameOver;
+		return true;
+	}
+}
+
+
+////////////////////////////////////////////////////////////
+/// ReplayWriter records moves of a game together with periodic
+/// keyframes. Records are collected in memory and written to the
+/// file by a background thread, so recording never waits for I/O.
+////////////////////////////////////////////////////////////
+class ReplayWriter {
+public:
+	ReplayWriter() {}
+
+	ReplayWriter(const ReplayWriter&) = delete;
+	ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+	~ReplayWriter() {
+		close();
+	}
+
+	// Starts recording the game on board into a file. Returns false if the file can't be opened
+	bool open(const std::string& fileName, const Board& board, std::uint32_t interval = 1024) {
+		close();
+
+		_file.open(fileName, std::ios::binary | std::ios::trunc);
+		if (!_file)
+			return false;
+
+		_interval = interval;
+		_moves = 0;
+		_offset = 0;
+		_index.clear();
+		_pilot = board.pilot_state();
+		_pathLeft = board.path().size();
+		_stop = false;
+		_writer = std::thread(&ReplayWriter::write_loop, this);
+
+		_buffer.insert(_buffer.end(), replay::magic, replay::magic + 4);
+		replay::put(_buffer, replay::version);
+		replay::put(_buffer, static_cast<std::int32_t>(board.size()));
+		replay::put(_buffer, _interval);
+		for (IntT tile = 0; tile < board.size() * board.size(); ++tile)
+			replay::put(_buffer, static_cast<std::uint8_t>(board.is_inside(tile)));
+		keyframe(board);
+		return true;
+	}
+
+	// The writer is recording
+	bool isOpen() const {
+		return _writer.joinable();
+	}
+
+	// Records the move that has just been made on board (and the decision of the autopilot before it, if it made one)
+	void record(const Board& board) {
+		if (!isOpen())
+			return;
+
+		// A path that ran out was followed by a decision, which planned this move and what is left of the path
+		const auto pilot = board.pilot_state();
+		if (_pathLeft == 0 && (!board.isPathEmpty() || !(pilot == _pilot))) {
+			_decision.assign(1, board.head(board.snake()));
+			_decision.insert(_decision.end(), board.path().begin(), board.path().end());
+			_buffer.push_back('P');
+			replay::put(_buffer, pilot, _decision);
+			_pilot = pilot;
+		}
+		_pathLeft = board.path().size();
+
+		_buffer.push_back('M');
+		replay::put(_buffer, static_cast<std::int32_t>(board.head(board.snake())));
+		++_moves;
+
+		if (_moves % _interval == 0)
+			keyframe(board);
+
+		if (_buffer.size() >= flushSize)
+			flush();
+	}
+
+	// Writes the index and finishes the file
+	void close() {
+		if (!isOpen())
+			return;
+
+		const std::uint64_t indexOffset = _offset + _buffer.size();
+		_buffer.push_back('I');
+		replay::put(_buffer, _moves);
+		replay::put(_buffer, static_cast<std::uint64_t>(_index.size()));
+		for (auto [move, offset] : _index) {
+			replay::put(_buffer, move);
+			replay::put(_buffer, offset);
+		}
+		replay::put(_buffer, indexOffset);
+		_buffer.insert(_buffer.end(), replay::indexMagic, replay::indexMagic + 4);
+		flush();
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_one();
+		_writer.join();
+		_file.close();
+	}
+
+private:
+	static constexpr size_t flushSize = 1 << 16;		// Bytes collected before handing them to the writer thread
+
+	std::ofstream _file;
+	std::uint32_t _interval = 1024;						// Moves between two keyframes
+	std::uint64_t _moves = 0;							// Moves recorded so far
+	std::uint64_t _offset = 0;							// File offset of the beginning of _buffer
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> _index;	// (move, offset) of every keyframe
+	Board::PilotState _pilot;							// State of the autopilot recorded last
+	size_t _pathLeft = 0;								// Tiles left on the path after the last move
+	VecIntT _decision;									// Path of a decision being recorded (reused)
+	std::vector<char> _buffer;							// Records not yet handed to the writer thread
+	std::vector<char> _pending;							// Records waiting to be written
+	std::thread _writer;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _stop = false;
+
+	// Records the full state of board
+	void keyframe(const Board& board) {
+		_index.emplace_back(_moves, _offset + _buffer.size());
+		_buffer.push_back('K');
+		replay::put(_buffer, _moves);
+		replay::put(_buffer, board.snapshot());
+	}
+
+	// Hands _buffer over to the writer thread
+	void flush() {
+		_offset += _buffer.size();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_pending.insert(_pending.end(), _buffer.begin(), _buffer.end());
+		}
+		_buffer.clear();
+		_wake.notify_one();
+	}
+
+	// Body of the writer thread
+	void write_loop() {
+		std::vector<char> chunk;
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true) {
+			_wake.wait(lock, [this] { return _stop || !_pending.empty(); });
+			if (_pending.empty() && _stop)
+				return;
+
+			chunk.swap(_pending);
+			lock.unlock();
+			_file.write(chunk.data(), chunk.size());
+			chunk.clear();
+			lock.lock();
+		}
+	}
+};
+
+
+////////////////////////////////////////////////////////////
+/// ReplayReader reconstructs the board at any move of a
+/// recorded game by restoring the nearest preceding keyframe.
+/// From there, step() plays the game on one move at a time.
+////////////////////////////////////////////////////////////
+class ReplayReader {
+public:
+	// Opens a replay file and loads its index. Returns false if the file is not a finished replay
+	bool open(const std::string& fileName) {
+		_file.close();
+		_file.clear();
+		_index.clear();
+		_file.open(fileName, std::ios::binary);
+		if (!_file)
+			return false;
+
+		char m[4];
+		std::uint32_t v;
+		std::int32_t size;
+		if (!_file.read(m, 4) || std::memcmp(m, replay::magic, 4) != 0 || !replay::get(_file, v) || v != replay::version ||
+			!replay::get(_file, size) || !replay::get(_file, _interval))
+			return false;
+		_size = size;
+
+		// Playable tiles
+		if (size < 3)
+			return false;
+		std::vector<char> playable(size * size);
+		if (!_file.read(playable.data(), playable.size()))
+			return false;
+		_graph = std::make_shared<const BoardGraph>(size, std::move(playable));
+
+		// Trailer
+		std::uint64_t indexOffset;
+		_file.seekg(-static_cast<std::streamoff>(sizeof(indexOffset) + 4), std::ios::end);
+		if (!replay::get(_file, indexOffset) || !_file.read(m, 4) || std::memcmp(m, replay::indexMagic, 4) != 0)
+			return false;
+
+		// Index
+		char tag;
+		std::uint64_t count;
+		_file.seekg(indexOffset);
+		if (!_file.get(tag) || tag != 'I' || !replay::get(_file, _moves) || !replay::get(_file, count))
+			return false;
+		_index.resize(count);
+		for (auto& [move, offset] : _index) {
+			if (!replay::get(_file, move) || !replay::get(_file, offset))
+				return false;
+		}
+		return !_index.empty();
+	}
+
+	// Number of moves in the replay
+	std::uint64_t moves() const {
+		return _moves;
+	}
+
+	// Dimension of the recorded board (including the wall)
+	IntT size() const {
+		return _size;
+	}
+
+	// Playable tiles of the recorded board
+	const std::shared_ptr<const BoardGraph>& graph() const {
+		return _graph;
+	}
+
+	// Sets board to the state after the given move, with the path and counters of the autopilot as they were then.
+	// Replays at most one keyframe interval of moves
+	bool seek(std::uint64_t move, Board& board) {
+		_position = _moves + 1;
+		if (move > _moves)
+			return false;
+
+		auto it = std::upper_bound(_index.begin(), _index.end(), move,
+			[](std::uint64_t m, const auto& entry) {
+				return m < entry.first;
+			});
+		auto [current, offset] = *std::prev(it);
+
+		char tag;
+		std::uint64_t keyframeMove;
+		Board::Snapshot snapshot;
+		_file.clear();
+		_file.seekg(offset);
+		if (!_file.get(tag) || tag != 'K' || !replay::get(_file, keyframeMove) || !replay::get(_file, snapshot))
+			return false;
+		snapshot.graph = _graph;
+		board.restore(snapshot);
+
+		for (_position = current; _position < move;) {
+			if (!next_move(board))
+				return false;
+		}
+		return true;
+	}
+
+	// Makes the move after the last one seek() or step() set board to (board must not have changed since). Returns false
+	// at the end of the replay
+	bool step(Board& board) {
+		return _position < _moves && next_move(board);
+	}
+
+private:
+	std::ifstream _file;
+	IntT _size = 0;
+	std::shared_ptr<const BoardGraph> _graph;		// Playable tiles of the recorded board
+	std::uint32_t _interval = 0;
+	std::uint64_t _moves = 0;
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> _index;	// (move, offset) of every keyframe
+	VecIntT _decision;									// Path of the decision being read (reused)
+	std::uint64_t _position = 0;						// Move the file is read up to (past _moves if unknown)
+
+	// Reads the records up to the next move and makes it on board, skipping keyframes and setting the decisions of the
+	// autopilot on the way
+	bool next_move(Board& board) {
+		char tag;
+		while (_file.get(tag)) {
+			if (tag == 'K') {
+				std::uint64_t keyframeMove;
+				Board::Snapshot snapshot;
+				if (!replay::get(_file, keyframeMove) || !replay::get(_file, snapshot))
+					break;
+				continue;
+			}
+			if (tag == 'P') {
+				Board::PilotState pilot;
+				if (!replay::get(_file, pilot, _decision))
+					break;
+				board.set_pilot_state(pilot, _decision);
+				continue;
+			}
+
+			std::int32_t head;
+			if (tag != 'M' || !replay::get(_file, head))
+				break;
+			board.move_head(head);
+			++_position;
+			return true;
+		}
+		_position = _moves + 1;
+		return false;
+	}
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// RunLengthBody stores the body of a snake as straight runs of
+/// segments (first tile, step, length), so its memory grows with
+/// the number of turns instead of the length. The head advances
+/// and the tail retracts in constant time. Every run is listed
+/// under its row (or column, if it is vertical), which gives the
+/// segment on a tile by looking at the runs of two lines only.
+/// A body of width 0 keeps every run in one list (still correct,
+/// only slower). BasicBoard keeps its vector body, whose searches
+/// slice and shift it as spans; MonteCarloPilot rollouts use this
+/// one.
+////////////////////////////////////////////////////////////
+template <typename TileT>
+class RunLengthBody {
+public:
+	RunLengthBody() {}
+
+	// Empty body on a board whose rows are width tiles long
+	explicit RunLengthBody(int width) : _width(width) {}
+
+	// Body of the given segments (head first) on a board whose rows are width tiles long
+	RunLengthBody(std::span<const TileT> snake, int width) : _width(width) {
+		for (auto it = snake.rbegin(); it != snake.rend(); ++it)
+			push_head(*it);
+	}
+
+	std::int64_t length() const {
+		return _length;
+	}
+
+	bool empty() const {
+		return _length == 0;
+	}
+
+	// Number of straight runs (one more than the turns of the body)
+	size_t runs() const {
+		return _runs.size();
+	}
+
+	TileT head() const {
+		const Run& run = _runs.back();
+		return run.first + run.step * (run.placed - 1);
+	}
+
+	TileT tail() const {
+		const Run& run = _runs.front();
+		return run.first + run.step * run.removed;
+	}
+
+	// A segment lies on tile
+	bool contains(TileT tile) const {
+		return index_of(tile) >= 0;
+	}
+
+	// Index of the segment on tile (0 is the head), or -1
+	std::int64_t index_of(TileT tile) const {
+		const int row = line(tile, 1), column = line(tile, _width);
+		if (auto index = index_in(row, tile); index >= 0 || row == column)
+			return index;
+		return index_in(column, tile);
+	}
+
+	// Segment at index (0 is the head; walks the runs)
+	TileT operator[](std::int64_t index) const {
+		for (auto run = _runs.rbegin(); run != _runs.rend(); ++run) {
+			const std::int64_t count = run->placed - run->removed;
+			if (index < count)
+				return run->first + run->step * (run->placed - 1 - index);
+			index -= count;
+		}
+		return -1;
+	}
+
+	// Moves the head to a neighbouring tile (the body grows by one)
+	void push_head(TileT tile) {
+		const int step = _runs.empty() ? 0 : tile - head();
+		if (_runs.empty() || _runs.back().step != step || step == 0) {
+			_runs.push_back({ tile, step, _headStamp + 1, 0, 0 });
+			_lines[line(tile, step)].push_back(_firstRun + _runs.size() - 1);
+		}
+		++_runs.back().placed;
+		++_headStamp;
+		++_length;
+	}
+
+	// Removes the last segment
+	void pop_tail() {
+		Run& run = _runs.front();
+		--_length;
+		if (++run.removed < run.placed)
+			return;
+
+		// The run is gone, it is the oldest one of its line
+		auto list = _lines.find(line(run.first, run.step));
+		list->second.pop_front();
+		if (list->second.empty())
+			_lines.erase(list);
+		_runs.pop_front();
+		++_firstRun;
+	}
+
+	// Moves the body one tile forward (the head to tile, the tail leaves its tile)
+	void advance(TileT tile) {
+		pop_tail();
+		push_head(tile);
+	}
+
+	// Segments from the head to the tail
+	template <typename Vec = std::vector<TileT>>
+	Vec tiles() const {
+		Vec result;
+		result.reserve(_length);
+		for (auto run = _runs.rbegin(); run != _runs.rend(); ++run) {
+			for (std::int64_t j = run->placed - 1; j >= run->removed; --j)
+				result.push_back(run->first + run->step * j);
+		}
+		return result;
+	}
+
+private:
+	// Straight part of the body: the segments first + step * j for removed <= j < placed, put there by the moves stamp + j
+	struct Run {
+		TileT first;
+		int step;								// Offset from a segment to the one put after it (0 if there is one tile)
+		std::int64_t stamp;
+		std::int64_t placed;
+		std::int64_t removed;
+	};
+
+	int _width = 0;
+	std::deque<Run> _runs;						// Runs from the tail to the head
+	std::unordered_map<int, std::deque<std::uint64_t>> _lines;	// Runs (by number) of every row and column, oldest first
+	std::uint64_t _firstRun = 0;				// Number of _runs.front() (runs are numbered as they are added)
+	std::int64_t _headStamp = 0;				// Move that put the head on its tile
+	std::int64_t _length = 0;
+
+	// Key of the row (step of 0 or +-1) or column (other steps) of tile in _lines
+	int line(TileT tile, int step) const {
+		if (_width == 0)
+			return 0;
+		return step == 0 || step == 1 || step == -1 ? 2 * (tile / _width) : 2 * (tile % _width) + 1;
+	}
+
+	// Index of the segment on tile among the runs of line, or -1
+	std::int64_t index_in(int key, TileT tile) const {
+		const auto list = _lines.find(key);
+		if (list == _lines.end())
+			return -1;
+
+		for (auto number : list->second) {
+			const Run& run = _runs[number - _firstRun];
+			const int offset = tile - run.first;
+			std::int64_t j;
+			if (run.step == 0)
+				j = offset == 0 ? 0 : -1;
+			else if (offset % run.step != 0)
+				continue;
+			else
+				j = offset / run.step;
+
+			if (j >= run.removed && j < run.placed)
+				return _headStamp - (run.stamp + j);
+		}
+		return -1;
+	}
+};
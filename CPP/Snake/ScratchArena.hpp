@@ -0,0 +1,91 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+
+
+////////////////////////////////////////////////////////////
+/// ScratchArena is a monotonic arena for short-lived temporaries.
+/// Everything allocated from resource() is released at once by
+/// reset(). If the arena ran out of its buffer since the last reset,
+/// the buffer grows, so once the peak usage has been seen no more
+/// heap allocations are made.
+////////////////////////////////////////////////////////////
+class ScratchArena {
+public:
+	ScratchArena() {
+		_resource.emplace(&_upstream);
+	}
+
+	// Scratch memory is never shared, a copy starts with an empty arena
+	ScratchArena(const ScratchArena&) : ScratchArena() {}
+
+	ScratchArena& operator=(const ScratchArena&) {
+		return *this;
+	}
+
+	// Memory resource to allocate temporaries from
+	std::pmr::memory_resource* resource() {
+		return &*_resource;
+	}
+
+	// Releases everything allocated since the last reset
+	void reset() {
+		_resource.reset();
+
+		_lastAllocations = _upstream.allocations;
+		if (_upstream.bytes > 0) {
+			// The old contents are garbage, so the new buffer is neither copied nor cleared (its pages are touched on use)
+			_size = 2 * (_size + _upstream.bytes);
+			_buffer.reset();
+			_buffer = std::make_unique_for_overwrite<std::byte[]>(_size);
+		}
+
+		_upstream.allocations = 0;
+		_upstream.bytes = 0;
+		if (!_buffer)
+			_resource.emplace(&_upstream);
+		else
+			_resource.emplace(_buffer.get(), _size, &_upstream);
+	}
+
+	// Number of heap allocations the arena made between the last two resets
+	size_t last_allocations() const {
+		return _lastAllocations;
+	}
+
+private:
+	// Heap resource that counts how much the arena overflowed its buffer
+	class CountingResource : public std::pmr::memory_resource {
+	public:
+		size_t allocations = 0;
+		size_t bytes = 0;
+
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			++allocations;
+			this->bytes += bytes;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+
+	std::unique_ptr<std::byte[]> _buffer;				// Memory handed out before the arena has to grow
+	size_t _size = 0;									// Bytes of _buffer
+	CountingResource _upstream;
+	std::optional<std::pmr::monotonic_buffer_resource> _resource;
+	size_t _lastAllocations = 0;
+};
@@ -0,0 +1,375 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#define SNAKE_SHARED_MEMORY 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Board.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// Shared board layout (POSIX shared memory object, native byte
+/// order): a Header, then capacity i32 body tiles (a ring buffer,
+/// the body runs forward from the head), capacity i32 items and
+/// capacity u8 playable flags.
+///
+/// The writer guards every change with a seqlock: the sequence is
+/// odd while it writes. A reader copies the state and keeps it if
+/// the sequence was even and unchanged across the copy and the
+/// header fits the region, otherwise it tries again a bounded
+/// number of times (a writer that died mid-write leaves the
+/// sequence odd for good). The writer never waits for readers, and
+/// a move of the same game only writes the new head, the length and
+/// the items.
+///
+/// Without <sys/mman.h> (e.g. on Windows) nothing can be opened.
+////////////////////////////////////////////////////////////
+namespace shared_board {
+
+	constexpr char magic[4] = { 'S', 'N', 'K', 'M' };
+	constexpr std::uint32_t version = 1;
+
+	struct Header {
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t capacity;					// Tiles of the largest board the region holds
+		std::uint32_t reserved;
+		std::uint64_t sequence;					// Seqlock, odd while the writer changes the state
+		std::uint64_t game;						// Games published so far (0: nothing was published)
+		std::uint64_t moves;					// Moves of the current game
+		std::int32_t size;						// Dimension of the board (including the wall)
+		std::int32_t length;
+		std::int32_t head;						// Index of the head in the body ring buffer
+		std::int32_t items;
+		std::uint8_t gameOver;
+		std::uint8_t won;
+	};
+
+	// Bytes of a region for boards of up to capacity tiles
+	inline size_t bytes(std::uint32_t capacity) {
+		return sizeof(Header) + capacity * (2 * sizeof(std::int32_t) + 1);
+	}
+
+	template <typename T>
+	void store(T& field, T value) {
+		std::atomic_ref<T>(field).store(value, std::memory_order_relaxed);
+	}
+
+	template <typename T>
+	T load(const T& field) {
+		return std::atomic_ref<T>(const_cast<T&>(field)).load(std::memory_order_relaxed);
+	}
+
+	// Mapping of a shared memory object (unmapped and closed by the destructor)
+	class Mapping {
+	public:
+		Mapping() {}
+
+		Mapping(const Mapping&) = delete;
+		Mapping& operator=(const Mapping&) = delete;
+
+		~Mapping() {
+			close();
+		}
+
+		// Creates (or truncates) the object name of the given size and maps it for writing
+		bool create(const std::string& name, size_t bytes) {
+			close();
+#ifdef SNAKE_SHARED_MEMORY
+			const int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+			if (fd < 0)
+				return false;
+			if (ftruncate(fd, bytes) == 0)
+				map(fd, bytes, PROT_READ | PROT_WRITE);
+			::close(fd);
+			if (_data)
+				_name = name;
+#endif
+			return _data != nullptr;
+		}
+
+		// Maps the existing object name for reading
+		bool open(const std::string& name) {
+			close();
+#ifdef SNAKE_SHARED_MEMORY
+			const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+			if (fd < 0)
+				return false;
+			struct stat info;
+			if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(Header))
+				map(fd, info.st_size, PROT_READ);
+			::close(fd);
+#endif
+			return _data != nullptr;
+		}
+
+		// Unmaps the object (and removes it if it was created here)
+		void close() {
+#ifdef SNAKE_SHARED_MEMORY
+			if (_data)
+				munmap(_data, _bytes);
+			if (!_name.empty())
+				shm_unlink(_name.c_str());
+#endif
+			_data = nullptr;
+			_bytes = 0;
+			_name.clear();
+		}
+
+		char* data() const {
+			return static_cast<char*>(_data);
+		}
+
+		size_t bytes() const {
+			return _bytes;
+		}
+
+	private:
+		void* _data = nullptr;
+		size_t _bytes = 0;
+		std::string _name;						// Name of an object created here
+
+#ifdef SNAKE_SHARED_MEMORY
+		void map(int fd, size_t bytes, int protection) {
+			void* data = mmap(nullptr, bytes, protection, MAP_SHARED, fd, 0);
+			if (data != MAP_FAILED) {
+				_data = data;
+				_bytes = bytes;
+			}
+		}
+#endif
+	};
+}
+
+
+////////////////////////////////////////////////////////////
+/// SharedBoardWriter publishes the state of a board into a shared
+/// memory object (see shared_board) for viewers in other
+/// processes. publish() after every move costs a few stores.
+////////////////////////////////////////////////////////////
+class SharedBoardWriter {
+public:
+	// Creates the shared memory object name (e.g. "/snake") for boards of dimension up to maxDim
+	bool open(const std::string& name, IntT maxDim) {
+		const std::uint32_t capacity = (maxDim + 2) * (maxDim + 2);
+		if (!_mapping.create(name, shared_board::bytes(capacity)))
+			return false;
+
+		std::memset(_mapping.data(), 0, _mapping.bytes());
+		auto& header = this->header();
+		std::memcpy(header.magic, shared_board::magic, 4);
+		header.version = shared_board::version;
+		header.capacity = capacity;
+		_game = 0;
+		return true;
+	}
+
+	// Removes the shared memory object
+	void close() {
+		_mapping.close();
+	}
+
+	bool is_open() const {
+		return _mapping.data() != nullptr;
+	}
+
+	// Publishes board after moves moves of its game (a new game starts with moves 0). Returns false if the board
+	// doesn't fit
+	template <typename BoardT>
+	bool publish(const BoardT& board, std::uint64_t moves) {
+		auto& header = this->header();
+		const auto& snake = board.snake();
+		const IntT capacity = header.capacity;
+		const IntT tiles = board.size() * board.size();
+		if (tiles > capacity || 1 + (IntT)board.extra_items().size() > capacity)
+			return false;
+
+		// Seqlock: odd while writing
+		const std::uint64_t sequence = header.sequence;
+		shared_board::store(header.sequence, sequence + 1);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		// The same game one move later only gets the new head, otherwise everything is written again
+		const bool next = moves > 0 && moves == _moves + 1 && snake.size() > 1 && snake[1] == _head &&
+			(IntT)snake.size() - _length <= 1;
+		if (next) {
+			_ring = (_ring + capacity - 1) % capacity;
+			shared_board::store(body()[_ring], std::int32_t(snake[0]));
+		}
+		else {
+			if (moves == 0 || board.size() != header.size)
+				shared_board::store(header.game, ++_game);
+			_ring = 0;
+			for (size_t i = 0; i < snake.size(); ++i)
+				shared_board::store(body()[i], std::int32_t(snake[i]));
+			for (IntT tile = 0; tile < tiles; ++tile)
+				shared_board::store(playable()[tile], std::uint8_t(board.is_inside(tile)));
+			shared_board::store(header.size, std::int32_t(board.size()));
+		}
+
+		shared_board::store(items()[0], std::int32_t(board.item()));
+		for (size_t i = 0; i < board.extra_items().size(); ++i)
+			shared_board::store(items()[i + 1], std::int32_t(board.extra_items()[i]));
+		shared_board::store(header.items, std::int32_t(1 + board.extra_items().size()));
+		shared_board::store(header.length, std::int32_t(snake.size()));
+		shared_board::store(header.head, std::int32_t(_ring));
+		shared_board::store(header.moves, moves);
+		shared_board::store(header.gameOver, std::uint8_t(board.gameOver()));
+		shared_board::store(header.won, std::uint8_t(board.won()));
+
+		std::atomic_ref<std::uint64_t>(header.sequence).store(sequence + 2, std::memory_order_release);
+
+		_moves = moves;
+		_head = snake[0];
+		_length = snake.size();
+		return true;
+	}
+
+private:
+	shared_board::Mapping _mapping;
+	std::uint64_t _game = 0;
+	std::uint64_t _moves = 0;					// Moves, head and length published last
+	IntT _head = -1;
+	IntT _length = 0;
+	IntT _ring = 0;								// Index of the head in the body ring buffer
+
+	shared_board::Header& header() {
+		return *reinterpret_cast<shared_board::Header*>(_mapping.data());
+	}
+
+	std::int32_t* body() {
+		return reinterpret_cast<std::int32_t*>(_mapping.data() + sizeof(shared_board::Header));
+	}
+
+	std::int32_t* items() {
+		return body() + header().capacity;
+	}
+
+	std::uint8_t* playable() {
+		return reinterpret_cast<std::uint8_t*>(items() + header().capacity);
+	}
+};
+
+
+////////////////////////////////////////////////////////////
+/// SharedBoardReader samples the state published by a
+/// SharedBoardWriter in another process, at any rate, without
+/// ever blocking the writer.
+////////////////////////////////////////////////////////////
+class SharedBoardReader {
+public:
+	// A consistent copy of the published state
+	struct State {
+		std::uint64_t game = 0;					// Changes when a new game starts
+		std::uint64_t moves = 0;
+		IntT size = 0;
+		std::vector<IntT> snake;				// From the head
+		std::vector<IntT> items;
+		std::vector<char> playable;
+		bool gameOver = false;
+		bool won = false;
+	};
+
+	// Maps the shared memory object name. Returns false if there is no writer (yet)
+	bool open(const std::string& name) {
+		if (!_mapping.open(name))
+			return false;
+
+		const auto& header = this->header();
+		if (std::memcmp(header.magic, shared_board::magic, 4) != 0 || header.version != shared_board::version ||
+			_mapping.bytes() < shared_board::bytes(header.capacity)) {
+			_mapping.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool is_open() const {
+		return _mapping.data() != nullptr;
+	}
+
+	// Copies the latest state into state. Returns false if nothing was published yet or no consistent copy was made
+	// within readAttempts tries (the writer is stuck in the middle of a change, or the header is corrupt)
+	bool read(State& state) const {
+		const auto& header = this->header();
+		const IntT capacity = header.capacity;
+
+		for (int attempt = 0; attempt < readAttempts; ++attempt) {
+			if (attempt > 0)
+				std::this_thread::yield();
+			const std::uint64_t before = std::atomic_ref<std::uint64_t>(const_cast<std::uint64_t&>(header.sequence))
+				.load(std::memory_order_acquire);
+			if (before & 1)
+				continue;
+
+			// A copy made while the writer changes the header may not fit the region, it is tried again
+			const IntT size = shared_board::load(header.size);
+			const IntT length = shared_board::load(header.length);
+			const IntT head = shared_board::load(header.head);
+			const IntT items = shared_board::load(header.items);
+			if (size < 0 || (std::int64_t)size * size > capacity || length < 0 || length > capacity || head < 0 ||
+				head >= capacity || items < 0 || items > capacity)
+				continue;
+
+			state.game = shared_board::load(header.game);
+			state.moves = shared_board::load(header.moves);
+			state.size = size;
+			state.gameOver = shared_board::load(header.gameOver);
+			state.won = shared_board::load(header.won);
+
+			state.snake.resize(length);
+			for (IntT i = 0; i < length; ++i)
+				state.snake[i] = shared_board::load(body()[(head + i) % capacity]);
+			state.items.resize(items);
+			for (IntT i = 0; i < items; ++i)
+				state.items[i] = shared_board::load(this->items()[i]);
+			state.playable.resize(state.size * state.size);
+			for (size_t tile = 0; tile < state.playable.size(); ++tile)
+				state.playable[tile] = shared_board::load(playable()[tile]);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (shared_board::load(header.sequence) == before)
+				return state.game > 0;
+		}
+		return false;
+	}
+
+private:
+	static constexpr int readAttempts = 1000;	// Tries of read() before it gives up on a writer
+
+	shared_board::Mapping _mapping;
+
+	const shared_board::Header& header() const {
+		return *reinterpret_cast<const shared_board::Header*>(_mapping.data());
+	}
+
+	const std::int32_t* body() const {
+		return reinterpret_cast<const std::int32_t*>(_mapping.data() + sizeof(shared_board::Header));
+	}
+
+	const std::int32_t* items() const {
+		return body() + header().capacity;
+	}
+
+	const std::uint8_t* playable() const {
+		return reinterpret_cast<const std::uint8_t*>(items() + header().capacity);
+	}
+};
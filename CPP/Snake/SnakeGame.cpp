@@ -1,18 +1,43 @@
-
-
 ////////////////////////////////////////////////////////////
 // Headers
 ////////////////////////////////////////////////////////////
 #include <string>
+#include <vector>
+#include <future>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
 
 #include "Board.hpp"
+#include "Replay.hpp"
+#include "Strategy.hpp"
+#include "MonteCarloPilot.hpp"
+#include "FrameProfiler.hpp"
+#include "InputQueue.hpp"
+#include "SharedBoard.hpp"
+#include "TripleBuffer.hpp"
+#ifdef SNAKE_EMBEDDED_ASSETS
+#include "EmbeddedAssets.hpp"
+#endif
 
 std::string resourcesDir() {
     return "resources/";
 }
 
+std::string replayFile() {
+    return "last_game.snkr";
+}
+
+std::string profileFile() {
+    return "frame_times.csv";
+}
+
 
 ////////////////////////////////////////////////////////////
 // Constants, variables 
@@ -22,26 +47,73 @@ std::string resourcesDir() {
 sf::RenderWindow window;
 sf::SoundBuffer itemSoundBuffer;
 sf::Sound itemSound;
+sf::Image snakeImage;
 sf::Texture snakeTexture;
 sf::Sprite snakeSprite;
+sf::Image tileImage;
 sf::Texture tileTexture;
 sf::Sprite tileSprite;
 sf::Font font;
 sf::Text pauseMessage;
+sf::Text profilerText;
 
 // Constatnts
 const IntT dim = 16;
 const IntT startingLength = 2;
+const IntT itemCount = 1;                       // Items on the board at the same time
 const float gameWidth = 800;
 const float gameHeight = gameWidth;
 
 // Variables
 sf::Vector2u tileSize;
+std::shared_ptr<const BoardGraph> boardMap;   // Obstacle map given on the command line (none: a plain dim x dim board)
+std::string viewName;                           // Shared memory the game is viewed from (none: the game is played here)
+std::string replayName;                         // Replay file the game is played back from (none: the game is played here)
+FrameProfiler profiler;
+#pragma endregion
+
+#pragma region Simulation
+// State of the game the render thread draws, published by the simulation thread after every change
+struct Snapshot {
+    std::shared_ptr<const BoardGraph> graph;    // None before the first game
+    std::vector<IntT> snake;
+    std::vector<IntT> items;
+    bool running = false;
+    bool gameOver = false;
+    std::string message;                        // Pause message of the last game (empty: the welcome message)
+    unsigned itemsEaten = 0;                    // Items eaten since the start (the render thread plays a sound for new ones)
+    unsigned plannerDecisions = 0;
+    float plannerUs = 0;                        // Latency of the last planner decision (only timed for the profiler)
+    double simulationUs = 0;                    // Time the simulation thread worked since the start (only timed for the profiler)
+};
+
+// Owned by the simulation thread
+using SimClock = std::chrono::steady_clock;
 Board board;
+ReplayWriter recorder;
+HeuristicPilot heuristic;
+MonteCarloPilot monteCarlo;
 enum Direction { Up, Down, Left, Right };
-Direction direction = Left, nextDirection = Left;
-bool isPlaying = false, isAutoPlaying = false;
-float timer = 0.0, delay = 0.1;
+Direction direction = Left;
+InputQueue<Direction> pendingDirections;
+bool isPlaying = false, isAutoPlaying = false, isMonteCarlo = false, isReplaying = false;
+Snapshot state;
+SimClock::time_point nextTick;
+const std::chrono::milliseconds tick(100);
+const std::chrono::microseconds plannerBudget(4000);   // Deadline of one autopilot step, well within a tick
+
+// Key pressed in the render thread, with the time its event arrived there
+struct KeyPress {
+    sf::Keyboard::Key key;
+    SimClock::time_point pressed;
+};
+
+// Shared by the threads
+TripleBuffer<Snapshot> snapshots;
+std::mutex keyMutex;
+std::condition_variable_any keyPressed;
+std::vector<KeyPress> pressedKeys;              // Keys for the simulation thread (guarded by keyMutex)
+std::atomic<bool> plannerTimed = false;           // The profiler measures, time the simulation and the planner decisions
 #pragma endregion
 
 
@@ -49,70 +121,472 @@ float timer = 0.0, delay = 0.1;
 // Functions
 ////////////////////////////////////////////////////////////
 
-// Draw tileSprite with given scale, coords and color
-static void draw(float scale, IntT coords, sf::Color color) {
-    tileSprite.setPosition(scale * (coords % board.size()), scale *(coords / board.size()));
+// Draw tileSprite with given scale, coords (on a board of the given size) and color
+static void draw(float scale, IntT size, IntT coords, sf::Color color) {
+    tileSprite.setPosition(scale * (coords % size), scale *(coords / size));
     tileSprite.setScale(scale/ tileSize.x, scale / tileSize.y);
     tileSprite.setColor(color);
     window.draw(tileSprite);
+    profiler.count_draw();
 }
 
-// Sets an appropriate string for when the game is over
-static std::string endingString(size_t score) {
-    return "\t\t\t\t   Score: " + std::to_string(score - startingLength) + "\n\n\t   Press S to start the game,\n\t    A to start the auto mode\n\t\t\t  or escape to exit.";
+// Loads an asset from the resources directory, or from the executable when it was built with SNAKE_EMBEDDED_ASSETS
+template <typename Asset>
+static bool loadAsset(Asset& asset, const std::string& file) {
+#ifdef SNAKE_EMBEDDED_ASSETS
+    auto data = embeddedAsset(file);
+    return !data.empty() && asset.loadFromMemory(data.data(), data.size());
+#else
+    return asset.loadFromFile(resourcesDir() + file);
+#endif
 }
 
-
-////////////////////////////////////////////////////////////
-/// Entry point of application
-///
-/// \return Application exit code
-///
-////////////////////////////////////////////////////////////
-int main()
-{
-    sf::Clock clock;
-
-    #pragma region Resources
-    // Create the window of the application
-    window.create(sf::VideoMode(static_cast<unsigned int>(gameWidth), static_cast<unsigned int>(gameHeight), 32), "Snake Game", sf::Style::Titlebar | sf::Style::Close);
-    window.setVerticalSyncEnabled(true);
-
-    // Load the sounds used in the game
-    if (!itemSoundBuffer.loadFromFile(resourcesDir() + "item.wav"))
-        return EXIT_FAILURE;
+// Sets up sounds, sprites and texts from the loaded assets (textures have to be created on the main thread)
+static bool setUpAssets() {
     itemSound.setBuffer(itemSoundBuffer);
 
     // Create the snake image texture:
-    if (!snakeTexture.loadFromFile(resourcesDir() + "snake.png"))
-        return EXIT_FAILURE;
+    if (!snakeTexture.loadFromImage(snakeImage))
+        return false;
     snakeSprite.setTexture(snakeTexture);
     snakeSprite.setScale(gameWidth/1000, gameHeight/1000);
     snakeSprite.setPosition((gameWidth - 320 * (gameWidth / 1000)) / 2 + 5, gameHeight/6);
 
     // Create the snake body part texture:
-    if (!tileTexture.loadFromFile(resourcesDir() + "tile.png"))
-        return EXIT_FAILURE;
+    if (!tileTexture.loadFromImage(tileImage))
+        return false;
     tileSprite.setTexture(tileTexture);
     tileSize = tileTexture.getSize();
 
-    // Load the text font
-    if (!font.loadFromFile(resourcesDir() + "tuffy.ttf"))
-        return EXIT_FAILURE;
-
     // Initialize the pause message
     pauseMessage.setFont(font);
     pauseMessage.setCharacterSize(40);
     pauseMessage.setPosition(120.f, gameHeight / 2);
     pauseMessage.setFillColor(sf::Color::White);
-    pauseMessage.setString("\t  Welcome to Snake Game!\n\n    Press S to start the game or\n  press A to start the auto mode.");
+    pauseMessage.setString("\t  Welcome to Snake Game!\n\n    Press S to start the game,\n  press A to start the auto mode or\n  M to start the Monte Carlo mode.");
+
+    // Initialize the profiling overlay
+    profilerText.setFont(font);
+    profilerText.setCharacterSize(14);
+    profilerText.setPosition(8.f, 8.f);
+    profilerText.setFillColor(sf::Color::Yellow);
+    return true;
+}
+
+// Direction the snake can't turn to from direction d
+static Direction opposite(Direction d) {
+    return d == Up ? Down : d == Down ? Up : d == Left ? Right : Left;
+}
+
+// Queues a pressed arrow key, unless it repeats or reverses the direction the snake will have before it. The latency of
+// the turn counts from the time the key event arrived
+static void queueDirection(sf::Keyboard::Key key, SimClock::time_point pressed) {
+    Direction d;
+    switch (key) {
+    case sf::Keyboard::Up: d = Up; break;
+    case sf::Keyboard::Down: d = Down; break;
+    case sf::Keyboard::Left: d = Left; break;
+    case sf::Keyboard::Right: d = Right; break;
+    default: return;
+    }
+
+    Direction before = pendingDirections.empty() ? direction : pendingDirections.back();
+    if (d != before && d != opposite(before))
+        pendingDirections.push(d, pressed);
+}
+
+// Reports the latency between pressing a key and the snake turning in the finished game
+static void logInputLatency() {
+    std::cout << "Input: " << pendingDirections.consumed() << " turns, key-to-move latency mean " << pendingDirections.mean_latency()
+        << " ms, max " << pendingDirections.max_latency() << " ms" << std::endl;
+}
+
+// Sets an appropriate string for when the game is over
+static std::string endingString(size_t score) {
+    return "\t\t\t\t   Score: " + std::to_string(score - startingLength) + "\n\n\t   Press S to start the game,\n\t    A to start the auto mode,\n\tM to start the Monte Carlo mode\n\t\t\t  or escape to exit.";
+}
+
+// Copies the game into the back buffer of the snapshots and publishes it
+static void publishState() {
+    Snapshot& snapshot = snapshots.back();
+    snapshot.graph = state.graph;
+    snapshot.snake.assign(board.snake().begin(), board.snake().end());
+    snapshot.items.assign(1, board.item());
+    snapshot.items.insert(snapshot.items.end(), board.extra_items().begin(), board.extra_items().end());
+    snapshot.running = isPlaying || isAutoPlaying || isReplaying;
+    snapshot.gameOver = board.gameOver();
+    snapshot.message = state.message;
+    snapshot.itemsEaten = state.itemsEaten;
+    snapshot.plannerDecisions = state.plannerDecisions;
+    snapshot.plannerUs = state.plannerUs;
+    snapshot.simulationUs = state.simulationUs;
+    snapshots.publish();
+}
+
+// Starts a game in the mode of key (S, A or M)
+static void startGame(sf::Keyboard::Key key) {
+    state.graph = boardMap ? boardMap : BoardGraph::rectangular(dim);
+    board = Board(state.graph, startingLength);
+    board.set_item_count(itemCount);
+    recorder.open(replayFile(), board);
+    nextTick = SimClock::now() + 2 * tick;
+
+    if (key == sf::Keyboard::S) {
+        isPlaying = true;
+        direction = Left;
+        pendingDirections.clear();
+    }
+    else {
+        isAutoPlaying = true;
+        isMonteCarlo = key == sf::Keyboard::M;
+    }
+}
+
+// Stops the game and shows message
+static void endGame(const std::string& message) {
+    isPlaying = isAutoPlaying = false;
+    recorder.close();
+    state.message = message;
+}
+
+// One tick of the normal mode
+static void playTick() {
+    #pragma region Controls
+    // One queued turn per tick, checked against the direction at this tick
+    if (!pendingDirections.empty()) {
+        Direction d = pendingDirections.pop();
+        if (d != opposite(direction))
+            direction = d;
+    }
+    #pragma endregion
+
+    auto& snake = board.snake();
+    IntT new_head = board.head(snake);
+
+    // New position for head
+    switch (direction) {
+    case Up:
+        new_head -= board.size();
+        break;
+    case Down:
+        new_head += board.size();
+        break;
+    case Left:
+        new_head -= 1;
+        break;
+    case Right:
+        new_head += 1;
+        break;
+    }
+
+    // Game over - LOSE
+    if (!board.can_move(new_head)) {
+        logInputLatency();
+        endGame("\t\t\t\t  You Lost!\n" + endingString(board.snake_length()));
+    }
+    // Move snake, item eaten
+    else if (board.move_head(new_head)) {
+        recorder.record(board);
+
+        // Game over - WIN
+        if (board.gameOver()) {
+            logInputLatency();
+            endGame("\t\t\t\t  You Won!\n" + endingString(board.snake_length()));
+        }
+        else
+            ++state.itemsEaten;
+    }
+    // Move snake
+    else
+        recorder.record(board);
+}
+
+// One tick of the auto mode, decisions are made by pilot within budget
+template <typename Strategy>
+static void autoPlayTick(PilotStrategy<Strategy>& pilot, std::chrono::microseconds budget) {
+    // Find new path to follow
+    if (board.isPathEmpty()) {
+        // Game over
+        if (board.gameOver()) {
+            if (!isMonteCarlo)
+                std::cout << "Planner: " << board.deadline_hits() << " of " << board.timed_steps() << " steps hit the "
+                    << plannerBudget.count() / 1000.0 << " ms deadline" << std::endl;
+            endGame("\t\t\t\t Game over!\n" + endingString(board.snake_length()));
+            return;
+        }
+
+        // Continue running
+        const bool timed = plannerTimed.load(std::memory_order_relaxed);
+        auto plannerStart = timed ? SimClock::now() : SimClock::time_point();
+        pilot.step(board, SimClock::now() + budget);
+        if (timed) {
+            state.plannerUs = std::chrono::duration<float, std::micro>(SimClock::now() - plannerStart).count();
+            ++state.plannerDecisions;
+        }
+    }
+
+    // If there is still path left, follow it
+    if (!board.isPathEmpty()) {
+        if (board.shift_snake())
+            ++state.itemsEaten;
+        recorder.record(board);
+    }
+}
+
+// Simulation thread: handles the keys from the render thread, moves the snake once per tick and publishes every change
+static void simulate(std::stop_token stop) {
+    std::vector<KeyPress> keys;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(keyMutex);
+            auto anyKey = [] { return !pressedKeys.empty(); };
+            if (isPlaying || isAutoPlaying)
+                keyPressed.wait_until(lock, stop, nextTick, anyKey);
+            else
+                keyPressed.wait(lock, stop, anyKey);
+            if (stop.stop_requested())
+                return;
+            keys.swap(pressedKeys);
+        }
+
+        // The work from here to publishing is the simulation time of the profiler
+        const bool timed = plannerTimed.load(std::memory_order_relaxed);
+        const auto workStart = timed ? SimClock::now() : SimClock::time_point();
+        bool changed = !keys.empty();
+        for (auto [key, pressed] : keys) {
+            if (!isPlaying && !isAutoPlaying && (key == sf::Keyboard::S || key == sf::Keyboard::A || key == sf::Keyboard::M))
+                startGame(key);
+            else if (isPlaying)
+                queueDirection(key, pressed);
+        }
+        keys.clear();
+
+        // Snake is ready to be moved (a late tick delays the next ones instead of running several at once)
+        auto now = SimClock::now();
+        if ((isPlaying || isAutoPlaying) && now >= nextTick) {
+            nextTick += tick;
+            if (nextTick <= now)
+                nextTick = now + tick;
+
+            if (isPlaying)
+                playTick();
+            else if (isMonteCarlo)
+                autoPlayTick(monteCarlo, monteCarlo.settings().budget);
+            else
+                autoPlayTick(heuristic, plannerBudget);
+            changed = true;
+        }
+
+        if (timed)
+            state.simulationUs += std::chrono::duration<double, std::micro>(SimClock::now() - workStart).count();
+        if (changed)
+            publishState();
+    }
+}
+
+// Viewer thread (instead of the simulation thread): samples the board another process publishes in the shared memory
+// viewName at about the frame rate and publishes every change
+static void view(std::stop_token stop) {
+    const std::chrono::milliseconds period(15), reopen(1000);
+    SharedBoardReader reader;
+    SharedBoardReader::State shared;
+    std::uint64_t game = 0, moves = 0;
+    auto lastChange = SimClock::now();
+
+    state.message = "\t   Waiting for a game in\n\t\t\t" + viewName;
+    publishState();
+    while (true) {
+        {
+            // Keys don't play anything here
+            std::unique_lock<std::mutex> lock(keyMutex);
+            keyPressed.wait_for(lock, stop, period, [] { return false; });
+            if (stop.stop_requested())
+                return;
+            pressedKeys.clear();
+        }
+
+        // A writer that stopped publishing may have been replaced by a new one
+        auto now = SimClock::now();
+        if (!reader.is_open() || now - lastChange > reopen) {
+            lastChange = now;
+            if (!reader.open(viewName))
+                continue;
+            game = moves = 0;
+        }
+        if (!reader.read(shared) || (shared.game == game && shared.moves == moves) || shared.snake.size() < 2)
+            continue;
+        lastChange = now;
+
+        if (shared.game != game) {
+            state.graph = std::make_shared<const BoardGraph>(shared.size, shared.playable);
+            game = shared.game;
+        }
+        else if (shared.snake.size() > state.snake.size())
+            ++state.itemsEaten;
+        moves = shared.moves;
+        state.snake = shared.snake;
+
+        Snapshot& snapshot = snapshots.back();
+        snapshot.graph = state.graph;
+        snapshot.snake = shared.snake;
+        snapshot.items.clear();
+        for (auto item : shared.items) {
+            if (item >= 0 && item < shared.size * shared.size)
+                snapshot.items.push_back(item);
+        }
+        snapshot.running = true;
+        snapshot.gameOver = shared.gameOver;
+        snapshot.message = state.message;
+        snapshot.itemsEaten = state.itemsEaten;
+        snapshots.publish();
+    }
+}
+
+// Replay thread (instead of the simulation thread): plays the replay file replayName back at the tick rate. Space pauses,
+// the left and right arrows jump seekMoves moves back and forward, Home and End go to the first and the last move
+static void playReplay(std::stop_token stop) {
+    const std::uint64_t seekMoves = 100;
+    ReplayReader reader;
+    std::uint64_t move = 0;
+    bool paused = false;
+    std::vector<KeyPress> keys;
+
+    if (!reader.open(replayName) || !reader.seek(move, board)) {
+        state.message = "\t   Can't play the replay\n\t\t\t" + replayName;
+        publishState();
+        return;
+    }
+    state.graph = reader.graph();
+    isReplaying = true;
+    publishState();
+
+    nextTick = SimClock::now() + tick;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(keyMutex);
+            auto anyKey = [] { return !pressedKeys.empty(); };
+            if (paused || move == reader.moves())
+                keyPressed.wait(lock, stop, anyKey);
+            else
+                keyPressed.wait_until(lock, stop, nextTick, anyKey);
+            if (stop.stop_requested())
+                return;
+            keys.swap(pressedKeys);
+        }
+
+        std::uint64_t target = move;
+        for (auto [key, pressed] : keys) {
+            if (key == sf::Keyboard::Space)
+                paused = !paused;
+            else if (key == sf::Keyboard::Left)
+                target = target > seekMoves ? target - seekMoves : 0;
+            else if (key == sf::Keyboard::Right)
+                target = std::min(target + seekMoves, reader.moves());
+            else if (key == sf::Keyboard::Home)
+                target = 0;
+            else if (key == sf::Keyboard::End)
+                target = reader.moves();
+        }
+        keys.clear();
+
+        // Next move of the playback
+        auto now = SimClock::now();
+        if (!paused && now >= nextTick) {
+            nextTick = now + tick;
+            if (target == move && target < reader.moves())
+                ++target;
+        }
+        if (target == move)
+            continue;
+
+        // Playing on reads the next move, a jump restores the nearest keyframe (so it costs at most a keyframe interval
+        // of moves)
+        const size_t length = board.snake_length();
+        if (!(target == move + 1 ? reader.step(board) : reader.seek(target, board))) {
+            isReplaying = false;
+            state.message = "\t   Can't play the replay\n\t\t\t" + replayName;
+            publishState();
+            return;
+        }
+        if (target == move + 1 && (size_t)board.snake_length() > length)
+            ++state.itemsEaten;
+        move = target;
+        publishState();
+    }
+}
+
+// Passes a key whose event arrived at pressed to the simulation thread
+static void pressKey(sf::Keyboard::Key key, SimClock::time_point pressed) {
+    {
+        std::lock_guard<std::mutex> lock(keyMutex);
+        pressedKeys.push_back({ key, pressed });
+    }
+    keyPressed.notify_one();
+}
+
+
+////////////////////////////////////////////////////////////
+/// Entry point of application
+///
+/// Usage: SnakeGame [map.txt | --view shm_name | --replay file.snkr]
+///
+/// With --view, the window only shows the game another process
+/// publishes in the shared memory shm_name (e.g. Benchmark). With
+/// --replay, it plays back a recorded game (every game is recorded
+/// into last_game.snkr) and can seek in it.
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    sf::Clock startup;
+
+    #pragma region Resources
+    // Load the obstacle map (or view a game in shared memory)
+    if (argc > 2 && std::string(argv[1]) == "--view")
+        viewName = argv[2];
+    else if (argc > 2 && std::string(argv[1]) == "--replay")
+        replayName = argv[2];
+    else if (argc > 1 && !(boardMap = BoardGraph::load(argv[1]))) {
+        std::cout << "Can't load map " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Create the window of the application
+    window.create(sf::VideoMode(static_cast<unsigned int>(gameWidth), static_cast<unsigned int>(gameHeight), 32), "Snake Game", sf::Style::Titlebar | sf::Style::Close);
+    window.setVerticalSyncEnabled(true);
+
+    // Load the sound, images and font on worker threads while the window is already running
+    std::vector<std::future<bool>> loading;
+    loading.push_back(std::async(std::launch::async, [] { return loadAsset(itemSoundBuffer, "item.wav"); }));
+    loading.push_back(std::async(std::launch::async, [] { return loadAsset(snakeImage, "snake.png"); }));
+    loading.push_back(std::async(std::launch::async, [] { return loadAsset(tileImage, "tile.png"); }));
+    loading.push_back(std::async(std::launch::async, [] { return loadAsset(font, "tuffy.ttf"); }));
+    bool assetsLoaded = false, startupLogged = false;
+    float firstFrameTime = -1, assetsTime = -1;
     #pragma endregion
 
+    // The game runs on its own thread at the tick rate, so waiting for vsync never delays it (stopped when main returns)
+    std::jthread simulation(!viewName.empty() ? view : !replayName.empty() ? playReplay : simulate);
+    unsigned itemsEaten = 0, plannerDecisions = 0;
+    double simulationUs = 0;
+
     // Application is running
     while (window.isOpen()) {
-        float time = clock.getElapsedTime().asSeconds();
-        clock.restart();
-        timer += time;
+        profiler.begin_frame();
+
+        // Assets finished loading
+        if (!assetsLoaded && std::all_of(loading.begin(), loading.end(), [](auto& f) { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; })) {
+            bool loaded = true;
+            for (auto& f : loading)
+                loaded = f.get() && loaded;
+            if (!loaded || !setUpAssets())
+                return EXIT_FAILURE;
+
+            assetsLoaded = true;
+            assetsTime = startup.getElapsedTime().asMilliseconds();
+        }
 
         // Handle events
         sf::Event event;
@@ -125,25 +599,22 @@ int main()
                 break;
             }
 
-            // Key pressed: play or auto-play
-            if (event.type == sf::Event::KeyPressed && !isPlaying && !isAutoPlaying) {
-
-                if (event.key.code == sf::Keyboard::S || event.key.code == sf::Keyboard::A) {
-
-                    board = Board(dim, startingLength);
-                    clock.restart();
-                    timer = -delay;
-
-                    if (event.key.code == sf::Keyboard::S) {
-                        isPlaying = true;
-                        direction = Left, nextDirection = Left;
-                    }
-                    else if (event.key.code == sf::Keyboard::A) {
-                        isAutoPlaying = true;
-                    }
-                }
+            // F3 toggles the profiling overlay, F4 toggles writing frame timings to the CSV file
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F3)
+                profiler.set_visible(!profiler.visible());
+            if (event.type == sf::Event::KeyPressed && event.key.code == sf::Keyboard::F4) {
+                if (profiler.csv_open())
+                    profiler.close_csv();
+                else if (!profiler.open_csv(profileFile()))
+                    std::cout << "Can't write " << profileFile() << std::endl;
             }
 
+            // Key pressed: the simulation starts a game (once the assets are loaded) or queues a turn. The key is timed here
+            // (SFML events carry no time), so the input latency includes the wait for the simulation thread and its queue
+            if (event.type == sf::Event::KeyPressed && (assetsLoaded ||
+                (event.key.code != sf::Keyboard::S && event.key.code != sf::Keyboard::A && event.key.code != sf::Keyboard::M)))
+                pressKey(event.key.code, SimClock::now());
+
             // Window size changed, adjust view appropriately
             if (event.type == sf::Event::Resized) {
                 sf::View view;
@@ -152,124 +623,77 @@ int main()
                 window.setView(view);
             }
         }
-
-        // Playing normal mode
-        if (isPlaying) {    
-
-            #pragma region Controls
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Up) && direction != Down) nextDirection = Up;
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Down) && direction != Up) nextDirection = Down;
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left) && direction != Right) nextDirection = Left;
-            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right) && direction != Left) nextDirection = Right;
-            #pragma endregion
-
-            // Snake is ready to be moved
-            if (timer > delay) {
-                timer = 0;
-                direction = nextDirection;
-                
-                auto& snake = board.snake();
-                IntT new_head = board.head(snake);
-
-                // New position for head
-                switch (direction) {
-                case Up:
-                    new_head -= board.size();
-                    break;
-                case Down:
-                    new_head += board.size();
-                    break;
-                case Left:
-                    new_head -= 1;
-                    break;
-                case Right:
-                    new_head += 1;
-                    break;
-                }
-
-                // Game over - LOSE
-                if (!board.is_inside(new_head) || (board.contains(snake, new_head) && board.tail(snake) != new_head)) {
-                    isPlaying = false;
-                    pauseMessage.setString("\t\t\t\t  You Lost!\n" + endingString(board.snake_length()));
-                }
-                // Item eaten
-                else if (new_head == board.item()) {
-                    board.set_snake(board.shift(new_head, snake, true));
-
-                    // Game over - WIN
-                    if ((IntT)snake.size() == (board.size() * board.size() - 4 * (board.size() - 1))) {
-                        isPlaying = false;
-                        pauseMessage.setString("\t\t\t\t  You Won!\n" + endingString(board.snake_length()));
-                    }
-                    // Find new position for item
-                    else {
-                        board.set_item(board.generate_item());
-                        itemSound.play();
-                    }
-                }
-                // Move snake
-                else
-                    board.set_snake(board.shift(new_head, snake, false));
-            }
-        }
-        // Playing auto mode
-        else if (isAutoPlaying) {
-
-            // Snake is ready to be moved
-            if (timer > delay) {
-                timer = 0;
-
-                // Find new path to follow
-                if (board.isPathEmpty()) {
-                    // Game over
-                    if (board.gameOver()) {
-                        isAutoPlaying = false;
-                        pauseMessage.setString("\t\t\t\t Game over!\n" + endingString(board.snake_length()));
-                    }
-                    // Continue running
-                    else
-                        board.autoPilotStep();
-                }
-
-                // If there is still path left, follow it
-                if (!board.isPathEmpty()) {
-                    if (board.shift_snake()) 
-                        itemSound.play();
-                }
-            }
+        plannerTimed.store(profiler.enabled(), std::memory_order_relaxed);
+        profiler.end_phase(FrameProfiler::Events);
+
+        // Take the latest state of the game
+        if (snapshots.update()) {
+            const Snapshot& game = snapshots.front();
+            if (game.itemsEaten > itemsEaten)
+                itemSound.play();
+            if (game.plannerDecisions > plannerDecisions)
+                profiler.add_planner(game.plannerUs);
+            if (game.simulationUs > simulationUs)
+                profiler.add_simulation(game.simulationUs - simulationUs);
+            if (!game.running && !game.message.empty())
+                pauseMessage.setString(game.message);
+            itemsEaten = game.itemsEaten;
+            plannerDecisions = game.plannerDecisions;
+            simulationUs = game.simulationUs;
         }
+        const Snapshot& game = snapshots.front();
+        profiler.end_phase(FrameProfiler::Snapshot);
 
         #pragma region Drawing Board
         // Clear the window
         window.clear(sf::Color(50, 50, 50));
 
-        if (isPlaying || isAutoPlaying) {
-            float scale = gameWidth / board.size();
+        if (game.running) {
+            const IntT size = game.graph->size();
+            float scale = gameWidth / size;
 
-            // Wall
-            for (IntT tile = 0; tile < board.size() * board.size(); ++tile) {
-                if (!board.is_inside(tile)) 
-                    draw(scale, tile, sf::Color::Black);
+            // Wall and obstacles
+            for (IntT tile = 0; tile < size * size; ++tile) {
+                if (!game.graph->playable(tile))
+                    draw(scale, size, tile, sf::Color::Black);
             }
 
-            // Item
-            draw(scale, board.item(), sf::Color::Red);
+            // Items
+            for (auto item : game.items)
+                draw(scale, size, item, sf::Color::Red);
 
             // Snake
-            auto& snake = board.snake();
+            auto& snake = game.snake;
             int gradient = 255 / (snake.size() - 1);
             for (IntT i = 0; i < (IntT)snake.size(); ++i) {
-                draw(scale, snake[i], sf::Color(gradient * i, 250, gradient * i));
+                draw(scale, size, snake[i], sf::Color(gradient * i, 250, gradient * i));
             }
         }
-        else {
+        else if (assetsLoaded) {
             // Draw the pause message
             window.draw(pauseMessage);
             window.draw(snakeSprite);
         }
 
+        // Profiling overlay (of the previous frames)
+        if (profiler.visible() && assetsLoaded) {
+            profilerText.setString(profiler.summary());
+            window.draw(profilerText);
+        }
+        profiler.end_phase(FrameProfiler::Drawing);
+
         // Display things on screen
         window.display();
+        profiler.end_phase(FrameProfiler::Display);
+        profiler.end_frame();
+
+        // Report how long the start took
+        if (firstFrameTime < 0)
+            firstFrameTime = startup.getElapsedTime().asMilliseconds();
+        if (assetsLoaded && !startupLogged) {
+            std::cout << "Startup: first frame after " << firstFrameTime << " ms, assets ready after " << assetsTime << " ms" << std::endl;
+            startupLogged = true;
+        }
         #pragma endregion
     }
 
@@ -0,0 +1,247 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.hpp"
+#include "BoardGraph.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// Solver finds the fewest moves that win a seeded game on a small
+/// board (up to 36 playable tiles, e.g. 6x6), as a reference for
+/// the autopilot. Games follow the rules of Board::can_move() and
+/// Board::move_head() and draw their items from the same generator.
+///
+/// The search is A* over the states of a game. A state is the
+/// body, the item and the state of the generator (which decides
+/// all the following items), packed into three 64-bit words: head,
+/// length and item in 6 bits each, then 2 bits of direction per
+/// segment. Every state is expanded once (the heuristic, the
+/// distance to the item plus one move per further item, never
+/// overestimates and is consistent). States the snake can't leave
+/// alive without winning are pruned. A search gives up after
+/// maxStates states.
+////////////////////////////////////////////////////////////
+class Solver {
+public:
+	static constexpr IntT maxDim = 6;
+
+	struct Result {
+		bool solved = false;					// The search finished (within maxStates)
+		long long moves = -1;					// Fewest moves to win (-1 if the game can't be won or it wasn't solved)
+		size_t states = 0;						// States expanded
+	};
+
+	// Solver for games of Board(dim, startingLength, seed). Throws std::invalid_argument if dim is not in 1..maxDim
+	Solver(IntT dim, IntT startingLength, size_t maxStates = 1 << 20)
+		: _dim(checked_dim(dim)), _startingLength(startingLength), _maxStates(maxStates), _graph(BoardGraph::rectangular(_dim)),
+		_tiles(_graph->tiles()), _offsets{ -_graph->size(), _graph->size(), -1, 1 } {}
+
+	// Solves the game of Board(dim, startingLength, seed)
+	Result solve(std::uint64_t seed) const {
+		const auto start = Board(_dim, _startingLength, seed).snapshot();
+		State state{ Board::Tiles(start.snake), start.item, Board::Random() };
+		std::istringstream generator(start.generator);
+		generator >> state.random;
+
+		Result result;
+		std::priority_queue<Open> open;
+		std::unordered_map<Key, long long, KeyHash> best;	// Fewest moves found to every state seen
+		const Key first = pack(state);
+		best[first] = 0;
+		open.push({ estimate(state), 0, first });
+
+		while (!open.empty()) {
+			const Open current = open.top();
+			open.pop();
+			if (best[current.key] < current.moves)
+				continue;
+			if (++result.states > _maxStates)
+				return result;
+			state = unpack(current.key);
+
+			for (auto next : _graph->neighbours(state.snake[0])) {
+				State after = state;
+				switch (move(after, next)) {
+				case Dead:
+					continue;
+				case Won:
+					result.solved = true;
+					result.moves = current.moves + 1;
+					return result;
+				case Alive:
+					break;
+				}
+				if (trapped(after))
+					continue;
+
+				const Key key = pack(after);
+				auto [it, inserted] = best.try_emplace(key, current.moves + 1);
+				if (!inserted && it->second <= current.moves + 1)
+					continue;
+				it->second = current.moves + 1;
+				open.push({ current.moves + 1 + estimate(after), current.moves + 1, key });
+			}
+		}
+
+		// No state wins
+		result.solved = true;
+		return result;
+	}
+
+private:
+	struct State {
+		Board::Tiles snake;
+		IntT item;
+		Board::Random random;
+	};
+
+	struct Key {
+		std::array<std::uint64_t, 3> words{};
+
+		bool operator==(const Key&) const = default;
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			std::uint64_t h = key.words[0];
+			for (size_t i = 1; i < key.words.size(); ++i)
+				h = ZobristKeys::mix(h ^ key.words[i]);
+			return h;
+		}
+	};
+
+	// A state waiting to be expanded, the one with the smallest estimate first (the deeper one of equal estimates)
+	struct Open {
+		long long estimate;
+		long long moves;
+		Key key;
+
+		bool operator<(const Open& other) const {
+			return estimate != other.estimate ? estimate > other.estimate : moves < other.moves;
+		}
+	};
+
+	enum Outcome { Alive, Dead, Won };
+
+	static_assert(sizeof(Board::Random) == sizeof(std::uint64_t) && std::is_trivially_copyable_v<Board::Random>,
+		"the state of the generator has to fit in a word of a Key");
+
+	IntT _dim;
+	IntT _startingLength;
+	size_t _maxStates;
+	std::shared_ptr<const BoardGraph> _graph;
+	IntT _tiles;
+	std::array<IntT, 4> _offsets;				// Neighbour offsets in the order of the directions of BoardGraph
+
+	// dim if the packed states hold a board of that dimension
+	static IntT checked_dim(IntT dim) {
+		if (dim < 1 || dim > maxDim)
+			throw std::invalid_argument("Solver supports boards of dimension 1 to " + std::to_string(maxDim));
+		return dim;
+	}
+
+	// Moves the head of state to new_head by the rules of Board
+	Outcome move(State& state, IntT new_head) const {
+		auto& snake = state.snake;
+		if (std::find(snake.begin(), snake.end() - 1, new_head) != snake.end() - 1)
+			return Dead;
+
+		const bool consumed = new_head == state.item;
+		if (consumed)
+			snake.push_back(snake.back());
+		std::shift_right(snake.begin(), snake.end(), 1);
+		snake.front() = new_head;
+
+		if (consumed) {
+			if ((IntT)snake.size() == _graph->playable_tiles())
+				return Won;
+			do {
+				state.item = random_below(state.random, _tiles);
+			} while (!_graph->playable(state.item) || std::find(snake.begin(), snake.end(), state.item) != snake.end());
+		}
+		return Alive;
+	}
+
+	// Moves at least needed to win: to the item, then one per further item
+	long long estimate(const State& state) const {
+		const IntT size = _graph->size();
+		const IntT head = state.snake[0];
+		const IntT distance = std::abs(head % size - state.item % size) + std::abs(head / size - state.item / size);
+		return distance + _graph->playable_tiles() - (IntT)state.snake.size() - 1;
+	}
+
+	// The head is shut in a region of free tiles that is too small to stay alive in until a segment next to it leaves
+	// (and the region doesn't hold every free tile, so the snake can't win inside it either)
+	bool trapped(const State& state) const {
+		const auto& snake = state.snake;
+		const IntT length = snake.size();
+		std::array<std::int8_t, 64> segment;
+		segment.fill(-1);
+		for (IntT i = 0; i < length; ++i)
+			segment[snake[i]] = i;
+
+		std::array<char, 64> seen{};
+		std::array<IntT, 64> queue;
+		size_t count = 0, region = 0;
+		IntT leaves = length;					// Moves until the first segment next to the region leaves its tile
+		queue[count++] = snake[0];
+		seen[snake[0]] = true;
+		for (size_t next = 0; next < count; ++next) {
+			for (auto n : _graph->neighbours(queue[next])) {
+				if (segment[n] >= 0) {
+					leaves = std::min(leaves, length - 1 - segment[n]);
+					continue;
+				}
+				if (!seen[n]) {
+					seen[n] = true;
+					queue[count++] = n;
+					++region;
+				}
+			}
+		}
+		return (IntT)region < leaves && (IntT)region < _graph->playable_tiles() - length;
+	}
+
+	Key pack(const State& state) const {
+		Key key;
+		const auto& snake = state.snake;
+		std::uint64_t bits[2] = { std::uint64_t(snake[0]) | std::uint64_t(snake.size()) << 6 | std::uint64_t(state.item) << 12, 0 };
+		for (size_t i = 1, bit = 18; i < snake.size(); ++i, bit += 2) {
+			const auto d = std::uint64_t(std::find(_offsets.begin(), _offsets.end(), snake[i] - snake[i - 1]) - _offsets.begin());
+			bits[bit / 64] |= d << (bit % 64);
+		}
+		key.words[0] = bits[0];
+		key.words[1] = bits[1];
+
+		std::memcpy(&key.words[2], &state.random, sizeof(state.random));
+		return key;
+	}
+
+	State unpack(const Key& key) const {
+		State state;
+		const IntT length = (key.words[0] >> 6) & 63;
+		state.snake.resize(length);
+		state.snake[0] = key.words[0] & 63;
+		state.item = (key.words[0] >> 12) & 63;
+		for (IntT i = 1, bit = 18; i < length; ++i, bit += 2)
+			state.snake[i] = state.snake[i - 1] + _offsets[(key.words[bit / 64] >> (bit % 64)) & 3];
+
+		std::memcpy(static_cast<void*>(&state.random), &key.words[2], sizeof(state.random));
+		return state;
+	}
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <chrono>
+
+#include "Board.hpp"
+
+
+////////////////////////////////////////////////////////////
+/// PilotStrategy is the interface of the autopilots, bound at
+/// compile time. A strategy derives from PilotStrategy<Strategy>
+/// and implements decide(board), and optionally decide(board,
+/// deadline). Each appends the next moves to the path of the board
+/// or ends the game. The game loop, playGame() and the benchmark
+/// take the strategy as a template parameter, so every decision is
+/// a direct call that can be inlined, with no virtual dispatch.
+////////////////////////////////////////////////////////////
+template <typename Derived>
+class PilotStrategy {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	// Plans the next moves of board
+	template <typename BoardT>
+	void step(BoardT& board) {
+		derived().decide(board);
+	}
+
+	// Plans the next moves of board by deadline (a strategy without decide(board, deadline) doesn't get one)
+	template <typename BoardT>
+	void step(BoardT& board, Clock::time_point deadline) {
+		if constexpr (requires { derived().decide(board, deadline); })
+			derived().decide(board, deadline);
+		else
+			derived().decide(board);
+	}
+
+protected:
+	PilotStrategy() = default;
+
+private:
+	Derived& derived() {
+		return static_cast<Derived&>(*this);
+	}
+};
+
+
+////////////////////////////////////////////////////////////
+/// HeuristicPilot is the breadth-first search heuristic of the
+/// board (BasicBoard::autoPilotStep()). Its state (the loop
+/// counters and caches) lives in the board, so one pilot can play
+/// any number of boards.
+////////////////////////////////////////////////////////////
+class HeuristicPilot : public PilotStrategy<HeuristicPilot> {
+public:
+	static constexpr const char* name = "bfs";
+
+	template <typename BoardT>
+	void decide(BoardT& board) {
+		board.autoPilotStep();
+	}
+
+	template <typename BoardT>
+	void decide(BoardT& board, Clock::time_point deadline) {
+		board.autoPilotStep(deadline);
+	}
+};
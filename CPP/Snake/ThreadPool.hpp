@@ -0,0 +1,135 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// ThreadPool keeps a fixed set of worker threads alive for the
+/// whole run. parallel_for() hands indices to the workers and to
+/// the calling thread, so it may be nested (a task can itself call
+/// parallel_for) and it still works with no workers at all.
+////////////////////////////////////////////////////////////
+class ThreadPool {
+public:
+	explicit ThreadPool(size_t workers) {
+		for (size_t i = 0; i < workers; ++i)
+			_workers.emplace_back(&ThreadPool::work, this);
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (auto& worker : _workers)
+			worker.join();
+	}
+
+	// Pool shared by the whole process (one thread per core, counting the caller)
+	static ThreadPool& shared() {
+		static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+		return pool;
+	}
+
+	// Number of threads that run tasks (workers and the caller)
+	size_t concurrency() const {
+		return _workers.size() + 1;
+	}
+
+	// Calls task(i) for every i in [0, count) and waits until all calls return
+	template <typename Task>
+	void parallel_for(size_t count, Task&& task) {
+		if (count == 0)
+			return;
+
+		Job job;
+		job.count = count;
+		job.task = &task;
+		job.invoke = [](void* t, size_t i) { (*static_cast<std::remove_reference_t<Task>*>(t))(i); };
+
+		if (count > 1 && !_workers.empty()) {
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_jobs.push_back(&job);
+			}
+			_wake.notify_all();
+		}
+
+		run(job);
+
+		// Wait for tasks taken by the workers, then make sure no worker touches the job anymore
+		while (job.done.load(std::memory_order_acquire) < count)
+			std::this_thread::yield();
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			auto it = std::find(_jobs.begin(), _jobs.end(), &job);
+			if (it != _jobs.end())
+				_jobs.erase(it);
+		}
+		while (job.active.load(std::memory_order_acquire) > 0)
+			std::this_thread::yield();
+	}
+
+private:
+	// A single parallel_for call
+	struct Job {
+		size_t count = 0;
+		void* task = nullptr;
+		void (*invoke)(void*, size_t) = nullptr;
+		std::atomic<size_t> next{ 0 };				// Next index to hand out
+		std::atomic<size_t> done{ 0 };				// Indices already finished
+		std::atomic<size_t> active{ 0 };			// Workers currently inside the job
+	};
+
+	std::vector<std::thread> _workers;
+	std::deque<Job*> _jobs;							// Jobs that still have indices to hand out
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	bool _stop = false;
+
+	// Runs indices of job until there are none left
+	static void run(Job& job) {
+		for (size_t i; (i = job.next.fetch_add(1, std::memory_order_relaxed)) < job.count; ) {
+			job.invoke(job.task, i);
+			job.done.fetch_add(1, std::memory_order_release);
+		}
+	}
+
+	// Body of a worker thread
+	void work() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		while (true) {
+			_wake.wait(lock, [this] { return _stop || !_jobs.empty(); });
+			if (_stop)
+				return;
+
+			Job* job = _jobs.front();
+			if (job->next.load(std::memory_order_relaxed) >= job->count) {
+				_jobs.pop_front();
+				continue;
+			}
+			job->active.fetch_add(1, std::memory_order_relaxed);
+			lock.unlock();
+
+			run(*job);
+
+			job->active.fetch_sub(1, std::memory_order_release);
+			lock.lock();
+		}
+	}
+};
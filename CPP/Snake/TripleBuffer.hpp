@@ -0,0 +1,56 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+////////////////////////////////////////////////////////////
+/// TripleBuffer passes values from one writer thread to one reader
+/// thread without locks. The writer fills back() and publishes it,
+/// the reader takes the latest published value with update() and
+/// reads it from front(). Each side owns one of the three buffers
+/// and the third one is swapped between them with an atomic
+/// exchange, so neither side ever waits for the other. The reader
+/// skips values it was too slow to see. A buffer comes back to the
+/// writer with an old value, which it should overwrite completely.
+////////////////////////////////////////////////////////////
+template <typename T>
+class TripleBuffer {
+public:
+	// Buffer the writer fills
+	T& back() {
+		return _buffers[_back];
+	}
+
+	// Makes back() the latest value, the writer gets another buffer
+	void publish() {
+		_back = _middle.exchange(_back | fresh, std::memory_order_acq_rel) & index;
+	}
+
+	// Takes the latest published value into front(). Returns false if nothing was published since the last call
+	bool update() {
+		if (!(_middle.load(std::memory_order_relaxed) & fresh))
+			return false;
+		_front = _middle.exchange(_front, std::memory_order_acq_rel) & index;
+		return true;
+	}
+
+	// Buffer the reader reads
+	const T& front() const {
+		return _buffers[_front];
+	}
+
+private:
+	static constexpr std::uint8_t index = 3;		// Bits of _middle holding the buffer index
+	static constexpr std::uint8_t fresh = 4;		// _middle holds a value the reader hasn't taken yet
+
+	std::array<T, 3> _buffers{};
+	std::uint8_t _back = 0;							// Owned by the writer
+	std::uint8_t _front = 1;						// Owned by the reader
+	std::atomic<std::uint8_t> _middle = 2;			// Buffer between them (and the fresh flag)
+};
@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "Board.hpp"
+#include "Headless.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+
+
+////////////////////////////////////////////////////////////
+// Constants
+////////////////////////////////////////////////////////////
+
+// Board dimensions the settings are tuned for
+const std::vector<IntT> dims = { 6, 8, 10, 12, 16 };
+const IntT startingLength = 2;
+
+// Values of the grid search
+const std::vector<double> tailChaseGrid = { 0.25, 0.5, 1, 1.5, 2, 3 };
+const std::vector<double> giveUpGrid = { 1, 2, 3, 4, 6, 8 };
+const std::vector<int> rotationGrid = { 0, 1, 2, 3 };
+
+
+////////////////////////////////////////////////////////////
+// Functions
+////////////////////////////////////////////////////////////
+
+// Games of one board dimension played with one set of settings
+struct Trial {
+    PilotSettings settings;
+    unsigned wins = 0;
+    long long length = 0;                       // Sum of the final lengths
+    double cpuSeconds = 0;                      // Sum of the CPU times of the games
+
+    // Wins per second of the games (the final length per second breaks ties between settings that never win)
+    bool operator<(const Trial& other) const {
+        const double score = wins / cpuSeconds, otherScore = other.wins / other.cpuSeconds;
+        if (score != otherScore)
+            return score < otherScore;
+        return length / cpuSeconds < other.length / other.cpuSeconds;
+    }
+};
+
+// CPU time of the calling thread in seconds. Without a per-thread clock it falls back to the wall time, which only
+// matches while every worker has a core to itself
+static double threadCpuSeconds() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+        return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Every combination of the grid values
+static std::vector<PilotSettings> gridSettings() {
+    std::vector<PilotSettings> settings;
+    for (auto tailChase : tailChaseGrid)
+        for (auto giveUp : giveUpGrid)
+            for (auto rotation : rotationGrid)
+                settings.push_back({ tailChase, giveUp, rotation });
+    return settings;
+}
+
+// samples settings drawn uniformly from the range of the grid (the same ones in every run)
+static std::vector<PilotSettings> randomSettings(size_t samples) {
+    Pcg32 random(2024);
+    auto between = [&](double low, double high) { return low + (high - low) * random() / 4294967296.0; };
+
+    std::vector<PilotSettings> settings;
+    for (size_t i = 0; i < samples; ++i) {
+        const double tailChase = between(tailChaseGrid.front(), tailChaseGrid.back());
+        const double giveUp = between(giveUpGrid.front(), giveUpGrid.back());
+        settings.push_back({ tailChase, giveUp, int(random_below(random, 4)) });
+    }
+    return settings;
+}
+
+// Plays the seeded games 1..games of dimension dim with every set of settings. The games run in parallel, each on a
+// single thread, which measures the CPU time it took (so games don't count the time other workers held the core)
+static std::vector<Trial> play(IntT dim, unsigned games, const std::vector<PilotSettings>& settings) {
+    std::vector<Trial> trials(settings.size());
+    std::vector<GameResult> results(settings.size() * games);
+    std::vector<double> seconds(results.size());
+    const long long maxMoves = 8LL * dim * dim * dim * dim;    // Ends games that some settings would drag on for long
+
+    ThreadPool::shared().parallel_for(results.size(), [&](size_t i) {
+        const double start = threadCpuSeconds();
+        Board board(dim, startingLength, i % games + 1);
+        board.set_pilot_settings(settings[i / games]);
+        results[i] = playAutoPilot(board, maxMoves);
+        seconds[i] = threadCpuSeconds() - start;
+    });
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        auto& trial = trials[i / games];
+        trial.settings = settings[i / games];
+        trial.wins += results[i].won;
+        trial.length += results[i].length;
+        trial.cpuSeconds += seconds[i];
+    }
+    return trials;
+}
+
+// Writes a trial as JSON
+static void print(FILE* out, const char* name, const Trial& trial, unsigned games) {
+    std::fprintf(out, "\"%s\": { \"tail_chase\": %.3f, \"give_up\": %.3f, \"rotation\": %d, \"win_rate\": %.4f, "
+        "\"mean_final_length\": %.3f, \"cpu_ms_per_game\": %.3f, \"wins_per_cpu_sec\": %.3f }", name, trial.settings.tailChase,
+        trial.settings.giveUp, trial.settings.rotation, double(trial.wins) / games, double(trial.length) / games,
+        1000 * trial.cpuSeconds / games, trial.wins / trial.cpuSeconds);
+}
+
+
+////////////////////////////////////////////////////////////
+/// Autopilot settings tuner. For every board size, plays the
+/// seeded games 1..games with many PilotSettings (all the values of
+/// the grid, or samples random ones from its range) on all cores,
+/// and prints the settings with the most wins per CPU-second next
+/// to the default ones as JSON.
+///
+/// Usage: Tuner [output.json | -] [grid | random] [samples] [games]
+///
+/// \return Application exit code
+///
+////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+    FILE* out = argc > 1 && std::strcmp(argv[1], "-") != 0 ? std::fopen(argv[1], "w") : stdout;
+    if (!out)
+        return EXIT_FAILURE;
+
+    const bool grid = !(argc > 2 && std::strcmp(argv[2], "random") == 0);
+    const size_t samples = argc > 3 ? std::atoi(argv[3]) : 64;
+    const unsigned games = argc > 4 ? std::atoi(argv[4]) : 20;
+
+    // The defaults come first, so they win ties
+    std::vector<PilotSettings> settings(1);
+    for (auto s : grid ? gridSettings() : randomSettings(samples)) {
+        if (!(s == settings[0]))
+            settings.push_back(s);
+    }
+
+    std::fprintf(out, "{\n  \"tuner\": \"autopilot\",\n  \"search\": \"%s\",\n  \"settings\": %zu,\n  \"games\": %u,\n  \"sizes\": [\n",
+        grid ? "grid" : "random", settings.size(), games);
+    for (size_t i = 0; i < dims.size(); ++i) {
+        const auto trials = play(dims[i], games, settings);
+        const auto best = std::max_element(trials.begin(), trials.end());
+
+        std::fprintf(out, "    { \"size\": %d, ", dims[i]);
+        print(out, "best", *best, games);
+        std::fprintf(out, ", ");
+        print(out, "default", trials[0], games);
+        std::fprintf(out, " }%s\n", i + 1 < dims.size() ? "," : "");
+        std::fflush(out);
+    }
+    std::fprintf(out, "  ]\n}\n");
+
+    if (out != stdout)
+        std::fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+////////////////////////////////////////////////////////////
+// Headers
+////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+////////////////////////////////////////////////////////////
+/// ZobristKeys holds the random keys of every tile of a board
+/// size. A board state hashes to the XOR of the keys of its
+/// parts: the head, every other segment together with the
+/// direction to the segment in front of it (so the order of the
+/// body is part of the hash), the item and the rotation of the
+/// neighbour directions.
+////////////////////////////////////////////////////////////
+class ZobristKeys {
+public:
+	explicit ZobristKeys(size_t tiles) : _keys(tiles * keysPerTile) {
+		std::uint64_t state = tiles;
+		for (auto& key : _keys)
+			key = mix(state += 0x9E3779B97F4A7C15ull);
+		for (auto& key : _rotation)
+			key = mix(state += 0x9E3779B97F4A7C15ull);
+	}
+
+	// Keys shared by all boards with the same number of tiles
+	static std::shared_ptr<const ZobristKeys> for_tiles(size_t tiles) {
+		static std::mutex mutex;
+		static std::map<size_t, std::shared_ptr<const ZobristKeys>> keys;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto& k = keys[tiles];
+		if (!k)
+			k = std::make_shared<const ZobristKeys>(tiles);
+		return k;
+	}
+
+	std::uint64_t head(size_t tile) const {
+		return _keys[tile * keysPerTile];
+	}
+
+	// Segment on tile whose predecessor lies in direction dir (0-3)
+	std::uint64_t segment(size_t tile, size_t dir) const {
+		return _keys[tile * keysPerTile + 1 + dir];
+	}
+
+	std::uint64_t item(size_t tile) const {
+		return _keys[tile * keysPerTile + 5];
+	}
+
+	std::uint64_t rotation(size_t r) const {
+		return _rotation[r];
+	}
+
+	// splitmix64 finalizer
+	static std::uint64_t mix(std::uint64_t x) {
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+		return x ^ (x >> 31);
+	}
+
+private:
+	static constexpr size_t keysPerTile = 6;	// Head, segment in four directions, item
+
+	std::vector<std::uint64_t> _keys;
+	std::uint64_t _rotation[4]{};
+};
+
+
+////////////////////////////////////////////////////////////
+/// StateSet is an open addressing set of state hashes that keeps
+/// its memory when cleared.
+////////////////////////////////////////////////////////////
+class StateSet {
+public:
+	// Adds a hash. Returns false if it was already there
+	bool insert(std::uint64_t hash) {
+		if (hash == 0)
+			hash = 1;
+		if (2 * (_count + 1) > _slots.size())
+			grow();
+
+		for (size_t i = hash & (_slots.size() - 1); ; i = (i + 1) & (_slots.size() - 1)) {
+			if (_slots[i] == hash)
+				return false;
+			if (_slots[i] == 0) {
+				_slots[i] = hash;
+				++_count;
+				return true;
+			}
+		}
+	}
+
+	// Removes a hash (the entries after it in its run move back, so every lookup still finds its hash)
+	void erase(std::uint64_t hash) {
+		if (hash == 0)
+			hash = 1;
+		if (_slots.empty())
+			return;
+
+		const size_t mask = _slots.size() - 1;
+		size_t i = hash & mask;
+		while (_slots[i] != hash) {
+			if (_slots[i] == 0)
+				return;
+			i = (i + 1) & mask;
+		}
+		for (size_t j = (i + 1) & mask; _slots[j] != 0; j = (j + 1) & mask) {
+			// An entry can move back to i if its home slot isn't between i and j
+			const size_t home = _slots[j] & mask;
+			if (((j - home) & mask) >= ((j - i) & mask)) {
+				_slots[i] = _slots[j];
+				i = j;
+			}
+		}
+		_slots[i] = 0;
+		--_count;
+	}
+
+	void clear() {
+		if (_count > 0)
+			std::fill(_slots.begin(), _slots.end(), 0);
+		_count = 0;
+	}
+
+	// Makes room for count hashes, so inserting them doesn't grow the set
+	void reserve(size_t count) {
+		while (2 * count > _slots.size())
+			grow();
+	}
+
+	size_t size() const {
+		return _count;
+	}
+
+	// Slots of the set (it only grows, so a change means an allocation)
+	size_t capacity() const {
+		return _slots.size();
+	}
+
+private:
+	std::vector<std::uint64_t> _slots;			// 0 marks an empty slot
+	size_t _count = 0;
+
+	void grow() {
+		std::vector<std::uint64_t> old(std::max<size_t>(64, 2 * _slots.size()), 0);
+		old.swap(_slots);
+		_count = 0;
+		for (auto hash : old) {
+			if (hash != 0)
+				insert(hash);
+		}
+	}
+};
+
+
+////////////////////////////////////////////////////////////
+/// TranspositionCache remembers a decision for each state hash
+/// (direct mapped, newer entries replace older ones). It is a
+/// cache: a copy (or an assigned cache) starts out empty.
+////////////////////////////////////////////////////////////
+template <typename Value>
+class TranspositionCache {
+public:
+	explicit TranspositionCache(size_t entries = 4096) : _capacity(std::bit_ceil(entries)) {}
+
+	TranspositionCache(const TranspositionCache& other) : _capacity(other._capacity) {}
+
+	TranspositionCache& operator=(const TranspositionCache& other) {
+		_capacity = other._capacity;
+		clear();
+		return *this;
+	}
+
+	// Decision stored for hash, or nullptr
+	const Value* find(std::uint64_t hash) const {
+		if (_entries.empty())
+			return nullptr;
+		auto& entry = _entries[hash & (_capacity - 1)];
+		if (!entry.used || entry.hash != hash)
+			return nullptr;
+		++_hits;
+		return &entry.value;
+	}
+
+	// Stores a decision for hash
+	void store(std::uint64_t hash, const Value& value) {
+		reserve();
+		_entries[hash & (_capacity - 1)] = { hash, value, true };
+	}
+
+	// Allocates the entries now instead of on the first store
+	void reserve() {
+		if (_entries.empty())
+			_entries.resize(_capacity);
+	}
+
+	// Entries allocated so far (0 before the first store or reserve())
+	size_t capacity() const {
+		return _entries.capacity();
+	}
+
+	// Forgets every decision
+	void clear() {
+		_entries.clear();
+	}
+
+	// Successful lookups so far
+	size_t hits() const {
+		return _hits;
+	}
+
+private:
+	struct Entry {
+		std::uint64_t hash = 0;
+		Value value{};
+		bool used = false;
+	};
+
+	size_t _capacity;
+	std::vector<Entry> _entries;				// Allocated on the first store
+	mutable size_t _hits = 0;
+};
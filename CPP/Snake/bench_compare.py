@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+"""Compares two outputs of Benchmark per board size.
+
+Usage: bench_compare.py baseline.json current.json [tolerance]
+
+Prints the relative change of every metric and exits with 1 if the
+autopilot got slower or played worse by more than tolerance (default 5 %).
+A metric that is 0 in the baseline (e.g. deadline_hit_rate without a
+budget, or win_rate on large boards) has no relative change, so its
+absolute change is compared to tolerance instead.
+"""
+
+import json
+import sys
+
+# Metric -> True if higher is better
+METRICS = {
+    "moves_per_sec": True,
+    "cpu_us_per_decision": False,
+    "win_rate": True,
+    "mean_final_length": True,
+    "moves_per_item": False,
+    "deadline_hit_rate": False,
+    "moves_over_optimal": False,
+}
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(__doc__)
+        return 2
+
+    with open(sys.argv[1]) as f:
+        baseline = {s["size"]: s for s in json.load(f)["sizes"]}
+    with open(sys.argv[2]) as f:
+        current = {s["size"]: s for s in json.load(f)["sizes"]}
+    tolerance = float(sys.argv[3]) if len(sys.argv) > 3 else 0.05
+
+    regressed = False
+    for size in sorted(baseline.keys() & current.keys()):
+        print(f"size {size}")
+        for metric, higher_is_better in METRICS.items():
+            if metric not in baseline[size] or metric not in current[size]:
+                continue
+            old, new = baseline[size][metric], current[size][metric]
+            change = (new - old) / old if old else new - old
+            worse = -change if higher_is_better else change
+            flag = "  REGRESSION" if worse > tolerance else ""
+            regressed |= bool(flag)
+            shown = f"{change:+8.1%}" if old else f"{change:+8.3f} abs"
+            print(f"  {metric:22} {old:14.3f} -> {new:14.3f}  {shown}{flag}")
+
+    return 1 if regressed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())